@@ -1,11 +1,12 @@
 ﻿#include "AudioController.h"
+#include "Metrics.h"
+#include "EventLog.h"
+#include "ConfigStore.h"
+#include "PcmAudioSource.h"
 #include <QRandomGenerator>
 #include <QDebug>
 #include <QFileInfo>
 #include <QDir>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
 #include <QFile>
 #include <QStandardPaths>
 
@@ -23,90 +24,145 @@ AudioController &AudioController::instance()
 
 AudioController::AudioController(QObject *parent) : QObject(parent)
 {
+	m_config = ConfigStore::instance().snapshot();
+	m_status = std::make_shared<StatusSnapshot>();
+
 	m_mainTimer = new QTimer(this);
 	connect(m_mainTimer, &QTimer::timeout, this, &AudioController::onTimerTick);
 
 	m_playbackMonitorTimer = new QTimer(this);
 	connect(m_playbackMonitorTimer, &QTimer::timeout, this, &AudioController::checkMediaStatus);
+
+	// 后台 I/O 线程：目录索引、WAV 合并、临时文件清理都在这里完成
+	m_ioThread = new QThread(this);
+	m_ioThread->setObjectName("xhs-guard-io");
+	m_ioContext = new QObject();
+	m_ioContext->moveToThread(m_ioThread);
+
+	for (int i = 0; i < 2; ++i) {
+		m_slots[i].owner = this;
+		m_slots[i].index = i;
+	}
+
+	m_sources = new SourceCache(this);
+	connect(m_sources, &SourceCache::sourceRenamed, this, &AudioController::onSourceRenamed, Qt::QueuedConnection);
+	m_ducking = new DuckingEngine(m_sources);
+
+	m_voiceIndex = new VoicePackIndex();
+	m_voiceIndex->moveToThread(m_ioThread);
+
+	m_timeCache = new TimeAnnouncementCache(m_voiceIndex);
+	m_timeCache->moveToThread(m_ioThread);
+
+	connect(m_ioThread, &QThread::finished, m_ioContext, &QObject::deleteLater);
+	connect(m_ioThread, &QThread::finished, m_timeCache, &QObject::deleteLater);
+	connect(m_ioThread, &QThread::finished, m_voiceIndex, &QObject::deleteLater);
 }
 
 AudioController::~AudioController()
 {
-	m_mainTimer->stop();
-	m_playbackMonitorTimer->stop();
+	shutdown();
+	delete m_ducking;
 }
 
 void AudioController::init()
 {
-	loadConfigFromDisk();
-	cleanUpOldTempFiles(0);
+	ConfigStore::instance().open(ConfigStore::defaultPath());
+	m_config = ConfigStore::instance().snapshot();
+	// 对话框保存、源改名和配置文件热加载都从这里生效
+	connect(&ConfigStore::instance(), &ConfigStore::changed, this, &AudioController::applyConfig);
+
+	m_sources->attach();
+	m_ducking->setParams(m_config->duckAttackMs, m_config->duckReleaseMs, m_config->duckCurve);
+	m_ioThread->start();
+	m_voiceIndex->setRoot(m_config->voicePackPath);
+	// 启动时清掉旧版本遗留的 xhs_time_*.wav 临时文件
+	runOnIoThread([this]() { cleanUpOldTempFiles(); });
+	applyTimeCacheConfig(*m_config);
 	m_mainTimer->start(1000);
 	resetTimeTrigger();
 	resetNoiseTrigger();
 }
 
-void AudioController::loadConfigFromDisk()
+void AudioController::shutdown()
 {
-	char *path_c = obs_module_config_path("xhs-guard-config.json");
-	if (!path_c)
-		return;
-	QString path = QString::fromUtf8(path_c);
-	bfree(path_c);
+	m_mainTimer->stop();
+	m_playbackMonitorTimer->stop();
+	detachMediaSignals(0);
+	detachMediaSignals(1);
+	// 先让背景源回到原始音量，再放开源句柄
+	m_ducking->stop();
+	m_sources->detach();
+
+	if (m_ioThread->isRunning()) {
+		m_ioThread->quit();
+		m_ioThread->wait();
+	}
+}
 
-	QFile file(path);
-	if (!file.open(QIODevice::ReadOnly))
-		return;
+void AudioController::runOnIoThread(std::function<void()> job)
+{
+	QMetaObject::invokeMethod(m_ioContext, std::move(job), Qt::QueuedConnection);
+}
 
-	QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-	if (doc.isNull())
-		return;
+void AudioController::setConfig(const PluginConfig &config)
+{
+	// 校验、写盘后由 changed 信号回到 applyConfig
+	ConfigStore::instance().save(config);
+}
 
-	QJsonObject root = doc.object();
-	QMutexLocker locker(&m_mutex);
-
-	m_config.mediaSourceName = root["mediaSourceName"].toString();
-	m_config.voicePackPath = root["voicePackPath"].toString();
-	m_config.timeMin = root["timeMin"].toInt(120);
-	m_config.timeMax = root["timeMax"].toInt(180);
-	m_config.noiseMin = root["noiseMin"].toInt(90);
-	m_config.noiseMax = root["noiseMax"].toInt(120);
-	m_config.duckVolume = root["duckVolume"].toDouble(0.2);
-
-	if (root.contains("historySize"))
-		m_config.historySize = root["historySize"].toInt(30);
-	if (root.contains("shortFileThreshold"))
-		m_config.shortFileThreshold = root["shortFileThreshold"].toInt(6);
-
-	m_config.duckSources.clear();
-	QJsonArray arr = root["duckSources"].toArray();
-	for (const auto &val : arr) {
-		m_config.duckSources.append(val.toString());
-	}
+PluginConfig AudioController::getConfig() const
+{
+	return *ConfigStore::instance().snapshot();
 }
 
-void AudioController::setConfig(const PluginConfig &config)
+void AudioController::applyConfig()
 {
-	QMutexLocker locker(&m_mutex);
-	m_config = config;
+	m_config = ConfigStore::instance().snapshot();
+	const PluginConfig &config = *m_config;
+	m_ducking->setParams(config.duckAttackMs, config.duckReleaseMs, config.duckCurve);
+	// 语音包切换后重建索引 (路径未变时为空操作)
+	m_voiceIndex->setRoot(config.voicePackPath);
+	applyTimeCacheConfig(config);
+	emit configChanged(config);
+	publishStatus();
+}
+
+void AudioController::applyTimeCacheConfig(const PluginConfig &config)
+{
+	QString root = config.voicePackPath;
+	int minutes = config.timeCacheMinutes;
+	int capacity = config.timeCacheCapacity;
+	runOnIoThread([this, root, minutes, capacity]() {
+		m_timeCache->setRoot(root);
+		m_timeCache->setLimits(minutes, capacity);
+		m_timeCache->prebuild(QDateTime::currentDateTime());
+	});
 }
 
 void AudioController::enqueueTask(const QString &path, const QString &type)
 {
-	enqueueTaskAndReturn(path, type);
+	// 不需要返回文件名，解析和入队整个放到后台线程，调用方不碰磁盘
+	runOnIoThread([this, path, type]() { enqueueTaskAndReturn(path, type); });
 }
 
-QString AudioController::enqueueTaskAndReturn(const QString &path, const QString &type)
+QString AudioController::resolveTaskFile(const QString &path, const QString &type)
 {
-	QMutexLocker locker(&m_mutex);
-	QString fileToPlay = "";
+	// 会 stat 路径、首次访问目录时建索引，不能卡住界面线程
+	Q_ASSERT_X(QThread::currentThread() != thread(), "AudioController::resolveTaskFile",
+		   "path resolution must not run on the UI thread");
 	QFileInfo info(path);
+	if (info.isFile())
+		return path;
+	if (info.isDir())
+		return pickRandomFile(path, type == "noise");
+	return QString();
+}
 
-	if (info.isFile()) {
-		fileToPlay = path;
-	} else if (info.isDir()) {
-		fileToPlay = pickRandomFile(path, type == "noise");
-	}
-
+QString AudioController::enqueueTaskAndReturn(const QString &path, const QString &type)
+{
+	qint64 startMicros = Metrics::nowMicros();
+	QString fileToPlay = resolveTaskFile(path, type);
 	if (fileToPlay.isEmpty())
 		return "";
 
@@ -114,58 +170,188 @@ QString AudioController::enqueueTaskAndReturn(const QString &path, const QString
 	task.filePath = fileToPlay;
 	task.type = type;
 	// 🎯 新增：记录入队时间
-	task.addTime = QDateTime::currentSecsSinceEpoch();
+	task.addTime = QDateTime::currentMSecsSinceEpoch();
 
-	m_queue.append(task);
-	emit logMessage(QString::fromUtf8(">>> [入队] ") + QFileInfo(fileToPlay).fileName());
+	enqueuePreparedTask(task);
+	Metrics::instance().record(Metrics::Enqueue, Metrics::nowMicros() - startMicros);
+	return QFileInfo(fileToPlay).fileName();
+}
 
-	if (!m_isPlaying) {
-		m_isPlaying = true;
-		QTimer::singleShot(0, this, &AudioController::processNextTask);
+QList<EnqueueResult> AudioController::enqueueBatch(const QList<EnqueueRequest> &requests)
+{
+	qint64 startMicros = Metrics::nowMicros();
+	QList<EnqueueResult> results;
+	QList<AudioTask> tasks;
+	bool hasReply = false;
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+	for (const EnqueueRequest &req : requests) {
+		EnqueueResult result;
+		QString fileToPlay = resolveTaskFile(req.path, req.type);
+		if (!fileToPlay.isEmpty()) {
+			AudioTask task;
+			task.filePath = fileToPlay;
+			task.type = req.type;
+			task.addTime = now;
+			tasks.append(task);
+			hasReply = hasReply || task.type == "reply";
+			result.file = QFileInfo(fileToPlay).fileName();
+		}
+		results.append(result);
+	}
+	if (tasks.isEmpty())
+		return results;
+
+	// 整批一次发布，位置按发布前的队列长度推算 (并发入队时为近似值)
+	int position = m_queue.size();
+	m_queue.pushBatch(tasks);
+	for (EnqueueResult &result : results) {
+		if (!result.file.isEmpty())
+			result.position = ++position;
 	}
 
-	return QFileInfo(fileToPlay).fileName();
+	Metrics::instance().inc(Metrics::TasksEnqueued, quint64(tasks.size()));
+	Metrics::instance().observeQueueDepth(m_queue.size());
+	Metrics::instance().record(Metrics::Enqueue, Metrics::nowMicros() - startMicros);
+
+	EventLog::instance().post(LogEvent::BatchEnqueue, QString(), QString(), tasks.size());
+	schedulePlayback(hasReply);
+	return results;
 }
 
-void AudioController::processNextTask()
+void AudioController::enqueuePreparedTask(const AudioTask &task)
 {
-	m_playbackMonitorTimer->stop();
+	// 可在任意线程调用：入队是无锁的，只有空闲 -> 播放的切换需要回到控制器线程
+	m_queue.push(task);
+	Metrics::instance().inc(Metrics::TasksEnqueued);
+	Metrics::instance().observeQueueDepth(m_queue.size());
+	EventLog::instance().post(LogEvent::Enqueue, task.filePath, task.type);
+	schedulePlayback(task.type == "reply");
+}
+
+void AudioController::schedulePlayback(bool hasReply)
+{
+	bool expected = false;
+	if (m_isPlaying.compare_exchange_strong(expected, true)) {
+		QMetaObject::invokeMethod(this, [this]() { startPlayback(); }, Qt::QueuedConnection);
+	} else if (hasReply) {
+		// 回复可能需要打断正在播放的暖场，由控制器线程按策略判断
+		QMetaObject::invokeMethod(this, [this]() { preemptForReply(); }, Qt::QueuedConnection);
+	} else {
+		// 正在播放时趁空闲源预载下一段
+		QTimer::singleShot(0, this, &AudioController::prerollNextTask);
+	}
+}
+
+void AudioController::preemptForReply()
+{
+	if (!m_isPlaying || m_currentJobType != "noise" || !m_config->replyFirst || !m_config->replyPreempt ||
+	    m_queue.laneSize(TaskQueue::LaneReply) == 0) {
+		prerollNextTask();
+		return;
+	}
+
+	EventLog::instance().post(LogEvent::Preempt, m_currentFile, m_currentJobType);
+	Metrics::instance().inc(Metrics::TasksPreempted);
+	recordDecision("preempt", m_currentJobType, m_currentFile,
+		       QDateTime::currentMSecsSinceEpoch() - m_playStartTime);
+
+	// 换代后被打断片段的 stopped/ended 事件全部作废，直接切到下一个任务
+	m_slots[m_activeSlot].generation++;
+	processNextTask();
+}
+
+int AudioController::deadlineFor(const QString &type) const
+{
+	if (type == "reply")
+		return m_config->replyDeadlineMs;
+	if (type == "time")
+		return m_config->timeDeadlineMs;
+	return m_config->noiseDeadlineMs;
+}
 
-	QMutexLocker locker(&m_mutex);
+void AudioController::recordDecision(const QString &action, const QString &type, const QString &file, qint64 waitMs)
+{
+	SchedulerDecision decision;
+	decision.time = QDateTime::currentMSecsSinceEpoch();
+	decision.action = action;
+	decision.type = type;
+	decision.file = file;
+	decision.waitMs = waitMs;
+
+	QMutexLocker locker(&m_decisionMutex);
+	m_decisions.append(decision);
+	if (m_decisions.size() > kMaxDecisions)
+		m_decisions.removeFirst();
+}
 
-	// 🎯 修改：循环检查队列，直到找到有效任务或队列为空
-	while (!m_queue.isEmpty()) {
-		// 预取第一个任务（暂不移除）
-		AudioTask task = m_queue.first();
+QList<SchedulerDecision> AudioController::recentDecisions() const
+{
+	QMutexLocker locker(&m_decisionMutex);
+	return m_decisions;
+}
 
-		// 🎯 核心逻辑：检查报时任务是否过期 (>30秒)
-		if (task.type == "time") {
-			qint64 now = QDateTime::currentSecsSinceEpoch();
-			if (now - task.addTime > 30) {
-				// 任务已过期，移除并记录日志
-				m_queue.removeFirst();
-				emit logMessage(QString::fromUtf8("⚠️ 报时任务过期(>30s)，已丢弃: ") +
-						QFileInfo(task.filePath).fileName());
+void AudioController::startPlayback()
+{
+	int leadMs = 0;
+	// 闪避提前起跑：先开始压低背景音，留出 lead 时间再开播
+	if (!m_config->duckSources.isEmpty() && !m_ducking->isDucked()) {
+		m_ducking->duck(m_config->duckSources, m_config->duckVolume);
+		leadMs = qMax(0, m_config->duckLeadMs);
+	}
+	QTimer::singleShot(leadMs, Qt::PreciseTimer, this, &AudioController::processNextTask);
+}
+
+void AudioController::processNextTask()
+{
+	m_playbackMonitorTimer->stop();
 
-				// 继续下一次循环，检查下一个任务
+	// 只在控制器线程运行，队列本身无锁，这里不持任何锁：生产者入队不会被 OBS 调用卡住
+	for (;;) {
+		// 🎯 修改：循环取任务，直到找到有效任务或队列为空
+		AudioTask task;
+		while (m_queue.pop(task, m_config->replyFirst)) {
+			// 🎯 核心逻辑：按类型检查排队是否超时 (报时默认 30 秒)
+			QString fileName = QFileInfo(task.filePath).fileName();
+			qint64 waited = QDateTime::currentMSecsSinceEpoch() - task.addTime;
+			int deadline = deadlineFor(task.type);
+			if (deadline > 0 && waited > deadline) {
+				// 任务已过期，丢弃并记录日志
+				EventLog::instance().post(LogEvent::DropExpired, task.filePath, task.type, waited);
+				Metrics::instance().inc(Metrics::TasksDropped);
+				recordDecision("drop_expired", task.type, fileName, waited);
 				continue;
 			}
+
+			// 任务有效，开始播放
+			Metrics::instance().record(Metrics::QueueWait, waited * 1000);
+			recordDecision("play", task.type, fileName, waited);
+			playFile(task);
+			return;
 		}
 
-		// 任务有效，移除并开始播放
-		m_queue.removeFirst();
-		playFile(task);
-		return; // 退出函数，开始播放
+		// 先标记空闲再复查队列：生产者在两者之间入队时，要么由它接手启动，要么由这里继续处理
+		m_isPlaying.store(false);
+		if (m_queue.isEmpty())
+			break;
+		// 有任务排在某个生产者尚未链上的节点之后：该生产者发布完成后会调用 schedulePlayback 接手，
+		// 这里直接让出，不空转等待，也不做空闲收尾
+		if (!m_queue.hasReady())
+			return;
+		bool expected = false;
+		if (!m_isPlaying.compare_exchange_strong(expected, true))
+			return;
 	}
 
 	// === 如果代码走到这里，说明队列为空（或任务全被丢弃） ===
 
 	// 以下保持原有逻辑：清理状态、恢复音量、重置 OBS 源
-	m_isPlaying = false;
 	m_currentJobType = "";
+	m_currentFile.clear();
 	applyDucking(false);
+	cancelPreroll();
 
-	obs_source_t *source = obs_get_source_by_name(m_config.mediaSourceName.toUtf8().constData());
+	obs_source_t *source = m_sources->acquire(slotSourceName(m_activeSlot));
 	if (source) {
 		obs_data_t *settings = obs_data_create();
 		obs_data_set_string(settings, "local_file", "");
@@ -178,25 +364,50 @@ void AudioController::processNextTask()
 	}
 }
 
+bool AudioController::isDoubleBuffered() const
+{
+	return !m_config->secondaryMediaSourceName.isEmpty() &&
+	       m_config->secondaryMediaSourceName != m_config->mediaSourceName;
+}
+
+QString AudioController::slotSourceName(int slot) const
+{
+	return slot == 1 && isDoubleBuffered() ? m_config->secondaryMediaSourceName : m_config->mediaSourceName;
+}
+
 void AudioController::playFile(const AudioTask &task)
 {
 	m_currentJobType = task.type;
+	m_currentFile = QFileInfo(task.filePath).fileName();
+	m_currentAddTime = task.addTime;
+	m_playStartMicros = Metrics::nowMicros();
 
-	if (task.type == "time") {
-		QString baseName = QFileInfo(task.filePath).baseName();
-		QStringList parts = baseName.split('_');
-		if (parts.size() >= 3) {
-			bool ok;
-			qint64 ts = parts.last().toLongLong(&ok);
-			if (ok)
-				cleanUpOldTempFiles(ts);
-		}
+	// 双缓冲：下一段已在空闲源里预载好，直接切换过去
+	if (m_prerollActive && m_prerollTask.filePath == task.filePath && startPreroll())
+		return;
+	cancelPreroll();
+
+	obs_source_t *source = m_sources->acquire(slotSourceName(m_activeSlot));
+	bool pcmSource = isPcmAudioSource(source);
+	if (source && pcmSource && !task.filePath.endsWith(".wav", Qt::CaseInsensitive)) {
+		// 内置音频源只直接推送 PCM，MP3 等格式请改用 ffmpeg 媒体源
+		obs_source_release(source);
+		EventLog::instance().post(LogEvent::UnsupportedFormat, task.filePath, task.type);
+		QTimer::singleShot(0, this, &AudioController::processNextTask);
+		return;
 	}
 
-	obs_source_t *source = obs_get_source_by_name(m_config.mediaSourceName.toUtf8().constData());
 	if (source) {
 		applyDucking(true);
 
+		// 必须在 update 之前换代并挂好信号：内置音频源的推送线程可能在 update 返回前就发出 media_started，
+		// 换代晚了这个事件会被当成旧片段丢弃，随后的 media_ended 也只能等看门狗
+		m_slots[m_activeSlot].generation++;
+		m_mediaStarted = false;
+		m_playStartTime = QDateTime::currentMSecsSinceEpoch();
+		Metrics::instance().inc(Metrics::PlaybackStarted);
+		attachMediaSignals(m_activeSlot, source);
+
 		obs_data_t *settings = obs_data_create();
 		obs_data_set_string(settings, "local_file",
 				    QDir::toNativeSeparators(task.filePath).toUtf8().constData());
@@ -207,22 +418,255 @@ void AudioController::playFile(const AudioTask &task)
 		obs_data_release(settings);
 
 		obs_source_set_muted(source, false);
-		obs_source_set_enabled(source, false);
-		obs_source_set_enabled(source, true);
+		if (pcmSource) {
+			// 内置音频源在 update 时即接到时间轴上，无需重新激活
+			obs_source_set_enabled(source, true);
+		} else {
+			obs_source_set_enabled(source, false);
+			obs_source_set_enabled(source, true);
+		}
 
 		obs_source_release(source);
 
-		emit logMessage("[" + task.type + "] " + QString::fromUtf8("播放: ") +
-				QFileInfo(task.filePath).fileName());
+		EventLog::instance().post(LogEvent::Play, task.filePath, task.type);
 
-		m_playStartTime = QDateTime::currentMSecsSinceEpoch();
-		m_playbackMonitorTimer->start(200);
+		// 结束由 media_ended 信号驱动，轮询只作为看门狗兜底
+		m_playbackMonitorTimer->start(1000);
+		QTimer::singleShot(0, this, &AudioController::prerollNextTask);
 	} else {
-		emit logMessage(QString::fromUtf8(">>> [错误] 找不到媒体源，跳过"));
-		processNextTask();
+		EventLog::instance().post(LogEvent::SourceMissing, task.filePath, task.type);
+		// 延后到下一轮事件循环再取下一个任务，避免源缺失时在这里连续递归
+		QTimer::singleShot(0, this, &AudioController::processNextTask);
+	}
+}
+
+bool AudioController::startPreroll()
+{
+	int slot = 1 - m_activeSlot;
+	obs_source_t *source = m_sources->acquire(slotSourceName(slot));
+	if (!source)
+		return false;
+
+	applyDucking(true);
+
+	// 上一段所在的源静音闲置，留给下一次预载复用
+	obs_source_t *prev = m_sources->acquire(slotSourceName(m_activeSlot));
+	if (prev) {
+		obs_source_set_muted(prev, true);
+		obs_source_release(prev);
+	}
+
+	m_activeSlot = slot;
+	m_prerollActive = false;
+	m_playStartTime = QDateTime::currentMSecsSinceEpoch();
+	Metrics::instance().inc(Metrics::PlaybackStarted);
+
+	obs_media_state state = obs_source_media_get_state(source);
+	if (state == OBS_MEDIA_STATE_PLAYING || state == OBS_MEDIA_STATE_PAUSED) {
+		// 预载阶段可能已静音播出了几帧，回到开头再放
+		obs_source_media_set_time(source, 0);
+		obs_source_media_play_pause(source, false);
+		m_mediaStarted = true;
+		recordAudible();
+	} else if (state == OBS_MEDIA_STATE_OPENING || state == OBS_MEDIA_STATE_BUFFERING) {
+		// 还没打开完，等 media_started 自然开播
+		m_mediaStarted = false;
+	} else {
+		// 片段太短已在静音中播完，重新开始
+		m_mediaStarted = false;
+		obs_source_media_restart(source);
+	}
+	obs_source_set_muted(source, false);
+	obs_source_release(source);
+
+	EventLog::instance().post(LogEvent::PlaySeamless, m_prerollTask.filePath, m_prerollTask.type);
+
+	m_playbackMonitorTimer->start(1000);
+	QTimer::singleShot(0, this, &AudioController::prerollNextTask);
+	return true;
+}
+
+void AudioController::prerollNextTask()
+{
+	if (!isDoubleBuffered() || !m_isPlaying || m_prerollActive)
+		return;
+
+	AudioTask next;
+	if (!m_queue.peek(next, m_config->replyFirst))
+		return;
+	// 已过期的任务不值得预载，交给 processNextTask 丢弃
+	int deadline = deadlineFor(next.type);
+	if (deadline > 0 && QDateTime::currentMSecsSinceEpoch() - next.addTime > deadline)
+		return;
+
+	int slot = 1 - m_activeSlot;
+	obs_source_t *source = m_sources->acquire(slotSourceName(slot));
+	if (!source)
+		return;
+
+	m_slots[slot].generation++;
+	attachMediaSignals(slot, source);
+
+	// 静音打开文件，收到 media_started 后立即暂停，等当前片段结束再切换
+	obs_source_set_muted(source, true);
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_string(settings, "local_file", QDir::toNativeSeparators(next.filePath).toUtf8().constData());
+	obs_data_set_bool(settings, "looping", false);
+	obs_data_set_bool(settings, "close_when_inactive", false);
+	obs_data_set_bool(settings, "restart_on_activate", false);
+	obs_source_update(source, settings);
+	obs_data_release(settings);
+	obs_source_set_enabled(source, true);
+	obs_source_release(source);
+
+	m_prerollTask = next;
+	m_prerollActive = true;
+}
+
+void AudioController::cancelPreroll()
+{
+	if (!m_prerollActive)
+		return;
+	m_prerollActive = false;
+
+	int slot = 1 - m_activeSlot;
+	m_slots[slot].generation++;
+	obs_source_t *source = m_sources->acquire(slotSourceName(slot));
+	if (source) {
+		obs_source_set_muted(source, true);
+		obs_source_media_stop(source);
+		obs_source_release(source);
+	}
+}
+
+void AudioController::onMediaStartedSignal(void *data, calldata *)
+{
+	MediaSlot *slot = static_cast<MediaSlot *>(data);
+	slot->owner->postMediaEvent(slot->index, MediaStarted);
+}
+
+void AudioController::onMediaEndedSignal(void *data, calldata *)
+{
+	MediaSlot *slot = static_cast<MediaSlot *>(data);
+	slot->owner->postMediaEvent(slot->index, MediaEnded);
+}
+
+void AudioController::onMediaStoppedSignal(void *data, calldata *)
+{
+	MediaSlot *slot = static_cast<MediaSlot *>(data);
+	slot->owner->postMediaEvent(slot->index, MediaStopped);
+}
+
+void AudioController::postMediaEvent(int slot, MediaEvent event)
+{
+	// 运行在 OBS 媒体线程，只记录代号后投递，不碰任何控制器状态
+	quint64 generation = m_slots[slot].generation.load();
+	QMetaObject::invokeMethod(
+		this, [this, slot, event, generation]() { handleMediaEvent(slot, event, generation); },
+		Qt::QueuedConnection);
+}
+
+void AudioController::handleMediaEvent(int slot, MediaEvent event, quint64 generation)
+{
+	if (!m_isPlaying || generation != m_slots[slot].generation.load())
+		return;
+
+	if (slot != m_activeSlot) {
+		// 预载源一开播就暂停，等待切换
+		if (m_prerollActive && event == MediaStarted) {
+			obs_source_t *source = m_sources->acquire(slotSourceName(slot));
+			if (source) {
+				obs_source_media_play_pause(source, true);
+				obs_source_release(source);
+			}
+		}
+		return;
+	}
+
+	if (event == MediaStarted) {
+		if (!m_mediaStarted)
+			recordAudible();
+		m_mediaStarted = true;
+		return;
+	}
+
+	// 切换文件时源可能先报告上一个文件停止，未见 started 的前 2 秒内不当真
+	qint64 elapsed = QDateTime::currentMSecsSinceEpoch() - m_playStartTime;
+	if (!m_mediaStarted && elapsed < 2000)
+		return;
+
+	processNextTask();
+}
+
+void AudioController::onSourceRenamed(const QString &prevName, const QString &newName)
+{
+	// 用户在 OBS 里给源改名后，配置跟着走，避免插件突然找不到源
+	PluginConfig cfg = *m_config;
+	bool changed = false;
+	if (cfg.mediaSourceName == prevName) {
+		cfg.mediaSourceName = newName;
+		changed = true;
+	}
+	if (cfg.secondaryMediaSourceName == prevName) {
+		cfg.secondaryMediaSourceName = newName;
+		changed = true;
+	}
+	int idx = cfg.duckSources.indexOf(prevName);
+	if (idx != -1) {
+		cfg.duckSources[idx] = newName;
+		changed = true;
+	}
+	m_ducking->renameSource(prevName, newName);
+
+	if (changed) {
+		// 新名字同时写回配置文件，重启 OBS 后仍然有效
+		setConfig(cfg);
+		EventLog::instance().post(LogEvent::SourceRenamed, prevName, QString(), 0, newName);
+	}
+}
+
+void AudioController::attachMediaSignals(int slot, obs_source_t *source)
+{
+	MediaSlot &s = m_slots[slot];
+	if (s.signalSource && obs_weak_source_references_source(s.signalSource, source))
+		return;
+
+	detachMediaSignals(slot);
+
+	signal_handler_t *sh = obs_source_get_signal_handler(source);
+	signal_handler_connect(sh, "media_started", onMediaStartedSignal, &s);
+	signal_handler_connect(sh, "media_ended", onMediaEndedSignal, &s);
+	signal_handler_connect(sh, "media_stopped", onMediaStoppedSignal, &s);
+	s.signalSource = obs_source_get_weak_source(source);
+}
+
+void AudioController::detachMediaSignals(int slot)
+{
+	MediaSlot &s = m_slots[slot];
+	if (!s.signalSource)
+		return;
+
+	obs_source_t *source = obs_weak_source_get_source(s.signalSource);
+	if (source) {
+		signal_handler_t *sh = obs_source_get_signal_handler(source);
+		signal_handler_disconnect(sh, "media_started", onMediaStartedSignal, &s);
+		signal_handler_disconnect(sh, "media_ended", onMediaEndedSignal, &s);
+		signal_handler_disconnect(sh, "media_stopped", onMediaStoppedSignal, &s);
+		obs_source_release(source);
 	}
+	obs_weak_source_release(s.signalSource);
+	s.signalSource = nullptr;
+}
+
+void AudioController::recordAudible()
+{
+	Metrics &metrics = Metrics::instance();
+	metrics.record(Metrics::MediaOpen, Metrics::nowMicros() - m_playStartMicros);
+	if (m_currentJobType == "reply")
+		metrics.record(Metrics::ReplyEndToEnd, (QDateTime::currentMSecsSinceEpoch() - m_currentAddTime) * 1000);
 }
 
+// 看门狗：兜底处理丢失的媒体信号、卡死状态和 60 秒超时
 void AudioController::checkMediaStatus()
 {
 	if (!m_isPlaying) {
@@ -230,14 +674,15 @@ void AudioController::checkMediaStatus()
 		return;
 	}
 
-	obs_source_t *source = obs_get_source_by_name(m_config.mediaSourceName.toUtf8().constData());
+	obs_source_t *source = m_sources->acquire(slotSourceName(m_activeSlot));
 	if (source) {
 		obs_media_state state = obs_source_media_get_state(source);
 		qint64 now = QDateTime::currentMSecsSinceEpoch();
 		qint64 elapsed = now - m_playStartTime;
 
 		if (elapsed > 60000) {
-			emit logMessage(QString::fromUtf8(">>> [异常] 播放超时，强制跳过"));
+			EventLog::instance().post(LogEvent::PlaybackTimeout, m_currentFile, m_currentJobType);
+			Metrics::instance().inc(Metrics::PlaybackTimeouts);
 			obs_source_release(source);
 			processNextTask();
 			return;
@@ -265,232 +710,109 @@ void AudioController::checkMediaStatus()
 
 void AudioController::applyDucking(bool active)
 {
-	if (active) {
-		for (const QString &name : m_config.duckSources) {
-			obs_source_t *s = obs_get_source_by_name(name.toUtf8().constData());
-			if (s) {
-				if (!m_originalVolumes.contains(name)) {
-					float currentVol = obs_source_get_volume(s);
-					m_originalVolumes.insert(name, currentVol);
-				}
-				obs_source_set_volume(s, m_config.duckVolume);
-				obs_source_release(s);
-			}
-		}
-	} else {
-		QMapIterator<QString, float> i(m_originalVolumes);
-		while (i.hasNext()) {
-			i.next();
-			QString name = i.key();
-			float originalVol = i.value();
-			obs_source_t *s = obs_get_source_by_name(name.toUtf8().constData());
-			if (s) {
-				obs_source_set_volume(s, originalVol);
-				obs_source_release(s);
-			}
-		}
-		m_originalVolumes.clear();
-	}
+	// 实际的音量渐变由 DuckingEngine 的定时线程完成
+	if (active)
+		m_ducking->duck(m_config->duckSources, m_config->duckVolume);
+	else
+		m_ducking->release();
 }
 
 QString AudioController::pickRandomFile(const QString &path, bool useHistory)
 {
-	QDir dir(path);
-	QStringList filters;
-	filters << "*.wav" << "*.mp3";
-	QStringList files = dir.entryList(filters, QDir::Files);
+	// 文件列表来自内存索引，不再逐次扫描目录
+	QStringList files = m_voiceIndex->files(path);
 	if (files.isEmpty())
 		return "";
 
-	if (!useHistory || files.size() <= m_config.historySize) {
-		return dir.absoluteFilePath(files[QRandomGenerator::global()->bounded(files.size())]);
-	}
+	if (!useHistory)
+		return files[QRandomGenerator::global()->bounded(files.size())];
+
+	// 可能在 HTTP 或后台线程调用，配置从 ConfigStore 取快照
+	int historySize = ConfigStore::instance().snapshot()->historySize;
+
+	// 去重历史会被后台线程与 HTTP 入队同时访问
+	QMutexLocker locker(&m_historyMutex);
+	if (files.size() <= historySize)
+		return files[QRandomGenerator::global()->bounded(files.size())];
 
 	QString pickedFile;
 	int maxRetries = 20;
 	do {
-		pickedFile = dir.absoluteFilePath(files[QRandomGenerator::global()->bounded(files.size())]);
+		pickedFile = files[QRandomGenerator::global()->bounded(files.size())];
 		maxRetries--;
 	} while (m_history.contains(pickedFile) && maxRetries > 0);
 
 	m_history.append(pickedFile);
-	if (m_history.size() > m_config.historySize)
+	if (m_history.size() > historySize)
 		m_history.removeFirst();
 	return pickedFile;
 }
 
 double AudioController::getAudioDuration(const QString &filePath)
 {
-	QFile file(filePath);
-	if (!file.open(QIODevice::ReadOnly))
-		return 0.0;
-	qint64 fileSize = file.size();
-	QString ext = QFileInfo(filePath).suffix().toLower();
-	if (ext == "wav") {
-		file.seek(28);
-		QByteArray rateData = file.read(4);
-		if (rateData.size() < 4)
-			return 0.0;
-		quint32 byteRate = *reinterpret_cast<const quint32 *>(rateData.constData());
-		return byteRate > 0 ? (double)(fileSize - 44) / byteRate : 0.0;
-	}
-	return 0.0;
+	// WAV 元数据由索引首次解析后缓存，非 WAV 返回 0
+	return m_voiceIndex->wavInfo(filePath).duration();
 }
 
-void AudioController::cleanUpOldTempFiles(qint64 currentPlayingTs)
+void AudioController::cleanUpOldTempFiles()
 {
+	// 旧版本把报时拼接结果直接写在临时目录，启动时一次性清掉
 	QString tempPath = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
 	QDir dir(tempPath);
 	dir.setNameFilters(QStringList() << "xhs_time_*.wav");
-	for (const QFileInfo &fi : dir.entryInfoList(QDir::Files)) {
-		if (currentPlayingTs == 0) {
-			QFile::remove(fi.absoluteFilePath());
-		} else {
-			QStringList parts = fi.baseName().split('_');
-			if (parts.size() >= 3) {
-				bool ok;
-				qint64 fileTs = parts.last().toLongLong(&ok);
-				if (ok && fileTs < currentPlayingTs)
-					QFile::remove(fi.absoluteFilePath());
-			}
-		}
-	}
+	for (const QFileInfo &fi : dir.entryInfoList(QDir::Files))
+		QFile::remove(fi.absoluteFilePath());
 }
 
-QString AudioController::mergeWavFiles(const QStringList &files)
+int AudioController::getNoiseFileCount()
 {
-	if (files.isEmpty())
-		return "";
-	if (files.size() == 1)
-		return files[0];
-
-	QString tempName = QString("xhs_time_%1.wav").arg(QDateTime::currentMSecsSinceEpoch());
-	QString tempPath =
-		QStandardPaths::writableLocation(QStandardPaths::TempLocation).replace("\\", "/") + "/" + tempName;
-
-	QFile outFile(tempPath);
-	if (!outFile.open(QIODevice::WriteOnly))
-		return "";
-
-	QByteArray allPcmData;
-	quint16 audioFormat = 1;
-	quint16 numChannels = 2;
-	quint32 sampleRate = 44100;
-	quint32 byteRate = 176400;
-	quint16 blockAlign = 4;
-	quint16 bitsPerSample = 16;
-	bool formatCaptured = false;
-
-	for (const QString &filePath : files) {
-		QFile f(filePath);
-		if (!f.open(QIODevice::ReadOnly))
-			continue;
-		QByteArray content = f.readAll();
-		f.close();
-		if (content.size() < 44 || memcmp(content.constData(), "RIFF", 4) != 0)
-			continue;
-
-		int pos = 12;
-		while (pos + 8 <= content.size()) {
-			QByteArray chunkId = content.mid(pos, 4);
-			quint32 chunkSize = *reinterpret_cast<const quint32 *>(content.constData() + pos + 4);
-			if (!formatCaptured && chunkId == "fmt ") {
-				if (chunkSize >= 16 && pos + 8 + 16 <= content.size()) {
-					const char *ptr = content.constData() + pos + 8;
-					audioFormat = *reinterpret_cast<const quint16 *>(ptr);
-					numChannels = *reinterpret_cast<const quint16 *>(ptr + 2);
-					sampleRate = *reinterpret_cast<const quint32 *>(ptr + 4);
-					byteRate = *reinterpret_cast<const quint32 *>(ptr + 8);
-					blockAlign = *reinterpret_cast<const quint16 *>(ptr + 12);
-					bitsPerSample = *reinterpret_cast<const quint16 *>(ptr + 14);
-					formatCaptured = true;
-				}
-			} else if (chunkId == "data") {
-				int actualSize = qMin((int)chunkSize, content.size() - (pos + 8));
-				if (actualSize > 0)
-					allPcmData.append(content.mid(pos + 8, actualSize));
-			}
-			pos += 8 + chunkSize;
-		}
-	}
+	if (m_config->voicePackPath.isEmpty())
+		return 0;
+	return m_voiceIndex->fileCount(m_config->voicePackPath + "/noise");
+}
 
-	if (allPcmData.isEmpty()) {
-		outFile.close();
-		return "";
+void AudioController::publishStatus()
+{
+	// 只在控制器线程调用，版本号单调递增无需加锁
+	if (m_voiceNamePath != m_config->voicePackPath || m_voiceName.isEmpty()) {
+		m_voiceNamePath = m_config->voicePackPath;
+		m_voiceName = m_voiceNamePath.isEmpty() ? QString::fromUtf8("默认") : QDir(m_voiceNamePath).dirName();
 	}
 
-	QByteArray header;
-	header.resize(44);
-	char *h = header.data();
-	memcpy(h, "RIFF", 4);
-	quint32 fileSize = 36 + allPcmData.size();
-	memcpy(h + 4, &fileSize, 4);
-	memcpy(h + 8, "WAVE", 4);
-	memcpy(h + 12, "fmt ", 4);
-	quint32 fmtSize = 16;
-	memcpy(h + 16, &fmtSize, 4);
-	memcpy(h + 20, &audioFormat, 2);
-	memcpy(h + 22, &numChannels, 2);
-	memcpy(h + 24, &sampleRate, 4);
-	memcpy(h + 28, &byteRate, 4);
-	memcpy(h + 32, &blockAlign, 2);
-	memcpy(h + 34, &bitsPerSample, 2);
-	memcpy(h + 36, "data", 4);
-	quint32 dataSize = allPcmData.size();
-	memcpy(h + 40, &dataSize, 4);
-
-	outFile.write(header);
-	outFile.write(allPcmData);
-	outFile.close();
-	return tempPath;
-}
+	auto next = std::make_shared<StatusSnapshot>();
+	next->type = m_isPlaying ? "playing_" + m_currentJobType : "idle";
+	next->currentFile = m_currentFile;
+	next->queueDepth = m_queue.size();
+	next->nextTimeTrigger = m_nextTimeTrigger;
+	next->nextNoiseTrigger = m_nextNoiseTrigger;
+	next->enabled = m_config->scriptEnabled;
+	next->connected = (QDateTime::currentSecsSinceEpoch() - m_lastHeartbeatTime) < 10;
+	next->noiseFileCount = getNoiseFileCount();
+	next->voiceName = m_voiceName;
+
+	std::shared_ptr<const StatusSnapshot> prev = std::atomic_load(&m_status);
+	if (next->sameContent(*prev))
+		return;
 
-int AudioController::getNoiseFileCount()
-{
-	if (m_config.voicePackPath.isEmpty())
-		return 0;
-	QDir dir(m_config.voicePackPath + "/noise");
-	return dir.entryList(QStringList() << "*.wav" << "*.mp3", QDir::Files).size();
+	next->version = prev->version + 1;
+	std::atomic_store(&m_status, std::shared_ptr<const StatusSnapshot>(std::move(next)));
+	emit statusChanged();
 }
 
 void AudioController::onTimerTick()
 {
 	qint64 now = QDateTime::currentSecsSinceEpoch();
-	bool isConnected = (now - m_lastHeartbeatTime) < 10;
-
-	// 🎯 核心修复：防卡死自愈逻辑
-	// 如果插件认为正在播放，但 OBS 媒体源实际上已经停止/无状态超过 3 秒
-	// 且距离开始播放已经超过了 5 秒（避开加载期），则强制重置
-	if (m_isPlaying && (QDateTime::currentMSecsSinceEpoch() - m_playStartTime > 5000)) {
-		obs_source_t *source = obs_get_source_by_name(m_config.mediaSourceName.toUtf8().constData());
-		if (source) {
-			obs_media_state state = obs_source_media_get_state(source);
-			if (state != OBS_MEDIA_STATE_PLAYING && state != OBS_MEDIA_STATE_BUFFERING &&
-			    state != OBS_MEDIA_STATE_OPENING) {
-				// 发现逻辑状态与物理状态不符，强制自愈
-				m_isPlaying = false;
-				applyDucking(false);
-				m_playbackMonitorTimer->stop();
-			}
-			obs_source_release(source);
-		}
-	}
 
-	QString statusType = m_isPlaying ? "playing_" + m_currentJobType : "idle";
-	QString statusMsg = m_isPlaying ? QString::fromUtf8("正在执行音频任务")
-					: QString::fromUtf8("正在监控直播间...");
-	if (!m_queue.isEmpty()) {
-		statusMsg += QString(" (+%1)").arg(m_queue.size());
-	}
-
-	QString voiceName = "默认";
-	if (!m_config.voicePackPath.isEmpty())
-		voiceName = QDir(m_config.voicePackPath).dirName();
+	// 防卡死自愈由 checkMediaStatus 看门狗负责，这里不再重复查询媒体源
 
-	emit statusUpdated(statusType, statusMsg, m_nextTimeTrigger - now, m_nextNoiseTrigger - now, isConnected,
-			   getNoiseFileCount(), voiceName);
+	// 每进入新的一分钟，让后台补齐接下来几分钟的报时缓存
+	qint64 minute = now / 60;
+	if (minute != m_lastPrebuildMinute) {
+		m_lastPrebuildMinute = minute;
+		runOnIoThread([this]() { m_timeCache->prebuild(QDateTime::currentDateTime()); });
+	}
 
-	if (m_config.scriptEnabled) {
+	if (m_config->scriptEnabled) {
 		if (now >= m_nextTimeTrigger) {
 			triggerManualTime();
 			resetTimeTrigger();
@@ -500,52 +822,67 @@ void AudioController::onTimerTick()
 			resetNoiseTrigger();
 		}
 	}
+
+	publishStatus();
 }
 
 void AudioController::resetTimeTrigger()
 {
 	m_nextTimeTrigger = QDateTime::currentSecsSinceEpoch() +
-			    QRandomGenerator::global()->bounded(m_config.timeMin, m_config.timeMax + 1);
+			    QRandomGenerator::global()->bounded(m_config->timeMin, m_config->timeMax + 1);
 }
 void AudioController::resetNoiseTrigger()
 {
 	m_nextNoiseTrigger = QDateTime::currentSecsSinceEpoch() +
-			     QRandomGenerator::global()->bounded(m_config.noiseMin, m_config.noiseMax + 1);
+			     QRandomGenerator::global()->bounded(m_config->noiseMin, m_config->noiseMax + 1);
 }
 
 void AudioController::triggerManualTime()
 {
-	QString root = m_config.voicePackPath;
+	QString root = m_config->voicePackPath;
 	if (root.isEmpty())
 		return;
-	QStringList files;
-	QString fPrefix = pickRandomFile(root + "/prefix", false);
-	if (!fPrefix.isEmpty())
-		files << fPrefix;
-	QString fDate = root + "/date/" + QDateTime::currentDateTime().toString("MMdd") + ".wav";
-	if (QFile::exists(fDate))
-		files << fDate;
-	QString fTime = root + "/time/" + QDateTime::currentDateTime().toString("HHmm") + ".wav";
-	if (QFile::exists(fTime))
-		files << fTime;
 
-	if (files.isEmpty())
-		return;
-	QString mergedFile = mergeWavFiles(files);
-	if (!mergedFile.isEmpty())
-		enqueueTask(mergedFile, "time");
+	// 报时内容以触发时刻为准，过期判断也从此刻开始计算
+	QDateTime triggerTime = QDateTime::currentDateTime();
+	runOnIoThread([this, root, triggerTime]() {
+		// 报时音频预先拼好，这里只是随机选前缀后查表
+		QString fPrefix = pickRandomFile(root + "/prefix", false);
+		QString file = m_timeCache->lookup(triggerTime, fPrefix);
+		if (file.isEmpty())
+			return;
+
+		AudioTask task;
+		task.filePath = file;
+		task.type = "time";
+		task.addTime = triggerTime.toMSecsSinceEpoch();
+		enqueuePreparedTask(task);
+	});
 }
 
 void AudioController::triggerManualNoise()
 {
-	QString noiseDir = m_config.voicePackPath + "/noise";
-	QString f1 = pickRandomFile(noiseDir, true);
-	if (!f1.isEmpty()) {
-		enqueueTask(f1, "noise");
-		if (getAudioDuration(f1) < m_config.shortFileThreshold) {
+	QString noiseDir = m_config->voicePackPath + "/noise";
+	int shortFileThreshold = m_config->shortFileThreshold;
+
+	qint64 triggerTime = QDateTime::currentMSecsSinceEpoch();
+	runOnIoThread([this, noiseDir, shortFileThreshold, triggerTime]() {
+		QString f1 = pickRandomFile(noiseDir, true);
+		if (f1.isEmpty())
+			return;
+
+		AudioTask task;
+		task.filePath = f1;
+		task.type = "noise";
+		task.addTime = triggerTime;
+		enqueuePreparedTask(task);
+
+		if (getAudioDuration(f1) < shortFileThreshold) {
 			QString f2 = pickRandomFile(noiseDir, true);
-			if (!f2.isEmpty())
-				enqueueTask(f2, "noise");
+			if (!f2.isEmpty()) {
+				task.filePath = f2;
+				enqueuePreparedTask(task);
+			}
 		}
-	}
+	});
 }
\ No newline at end of file
@@ -6,13 +6,62 @@
 #include <QMutex>
 #include <QList>
 #include <QMap>
+#include <QThread>
+#include <functional>
+#include <atomic>
+#include <memory>
 #include "Common.h"
+#include "TaskQueue.h"
+#include "VoicePackIndex.h"
+#include "TimeAnnouncementCache.h"
+#include "SourceCache.h"
+#include "DuckingEngine.h"
+
+struct calldata;
+struct obs_source;
+struct obs_weak_source;
+
+// 批量入队的单条请求与结果，file 为空表示该条没有找到可播放的文件
+struct EnqueueRequest {
+	QString path;
+	QString type;
+};
+struct EnqueueResult {
+	QString file;
+	int position = 0; // 入队时在待播队列中的位置 (从 1 开始)
+};
+
+// 调度决策记录，用于统计回复从入队到开播的端到端延迟
+struct SchedulerDecision {
+	qint64 time = 0;   // 决策时刻 (毫秒)
+	QString action;    // "play", "drop_expired", "preempt"
+	QString type;
+	QString file;
+	qint64 waitMs = 0; // 入队到决策的排队时长；preempt 时为被打断片段已播放的时长
+};
 
-// 任务结构体
-struct AudioTask {
-	QString filePath;
-	QString type;   // "time", "noise", "reply"
-	qint64 addTime; // 🎯 新增：记录入队时间戳，用于超时判断
+// 控制器状态快照：发布后不可修改，内容变化时版本号加一
+// 倒计时只给出触发时刻 (秒级时间戳)，由各消费者自己按当前时间换算剩余秒数
+struct StatusSnapshot {
+	quint64 version = 0;
+	QString type = "idle"; // "idle" 或 "playing_<任务类型>"
+	QString currentFile;
+	int queueDepth = 0;
+	qint64 nextTimeTrigger = 0;
+	qint64 nextNoiseTrigger = 0;
+	bool enabled = false;
+	bool connected = false;
+	int noiseFileCount = 0; // -1: 素材库还在后台建立索引
+	QString voiceName;
+
+	// 比较除版本号外的全部字段
+	bool sameContent(const StatusSnapshot &other) const
+	{
+		return type == other.type && currentFile == other.currentFile && queueDepth == other.queueDepth &&
+		       nextTimeTrigger == other.nextTimeTrigger && nextNoiseTrigger == other.nextNoiseTrigger &&
+		       enabled == other.enabled && connected == other.connected &&
+		       noiseFileCount == other.noiseFileCount && voiceName == other.voiceName;
+	}
 };
 
 class AudioController : public QObject {
@@ -21,61 +70,138 @@ public:
 	static AudioController &instance();
 
 	void init();
+	void shutdown();
+	// 配置统一由 ConfigStore 保存和发布，这里只是转发
 	void setConfig(const PluginConfig &config);
-	PluginConfig getConfig() const { return m_config; }
+	PluginConfig getConfig() const;
 
+	// 线程安全：入队走无锁队列，播放启动转投到控制器线程
+	// enqueueTask 可在任意线程 (包括界面线程) 调用，路径解析放到后台 I/O 线程；
+	// 需要同步拿到文件名的 enqueueTaskAndReturn / enqueueBatch 会在调用线程解析路径、查目录索引，
+	// 只给 HTTP 服务线程这类非界面线程使用
 	void enqueueTask(const QString &path, const QString &type);
 	QString enqueueTaskAndReturn(const QString &path, const QString &type);
+	QList<EnqueueResult> enqueueBatch(const QList<EnqueueRequest> &requests);
 
 	void triggerManualTime();
 	void triggerManualNoise();
 
-	void recordHeartbeat() { m_lastHeartbeatTime = QDateTime::currentSecsSinceEpoch(); }
+	QList<SchedulerDecision> recentDecisions() const;
+
+	int queueDepth() const { return m_queue.size(); }
+
+	void recordHeartbeat() { m_lastHeartbeatTime.store(QDateTime::currentSecsSinceEpoch()); }
+
+	// 任意线程可读，返回最近一次发布的快照 (从不为空)
+	std::shared_ptr<const StatusSnapshot> statusSnapshot() const { return std::atomic_load(&m_status); }
 
 signals:
-	void logMessage(const QString &msg);
-	void statusUpdated(const QString &type, const QString &msg, qint64 tNext, qint64 nNext, bool isConnected,
-			   int noiseCount, const QString &voiceName);
+	// 快照内容变化时发出，接收方通过 statusSnapshot() 读取最新版本
+	void statusChanged();
+	// 配置变更后发出，其他线程的组件据此刷新自己持有的副本
+	void configChanged(const PluginConfig &config);
 
 private slots:
 	void onTimerTick();
 	void checkMediaStatus();
+	void applyConfig();
 
 private:
 	AudioController(QObject *parent = nullptr);
 	~AudioController();
 
-	void loadConfigFromDisk();
+	void publishStatus();
+
+	// 所有磁盘 I/O 在后台线程执行，准备好的任务再投递回控制器线程入队
+	void runOnIoThread(std::function<void()> job);
+	QString resolveTaskFile(const QString &path, const QString &type);
+	void enqueuePreparedTask(const AudioTask &task);
+	void schedulePlayback(bool hasReply);
+	void startPlayback();
+	void preemptForReply();
+	int deadlineFor(const QString &type) const;
+	void recordDecision(const QString &action, const QString &type, const QString &file, qint64 waitMs);
+	void recordAudible();
+	void applyTimeCacheConfig(const PluginConfig &config);
 	void playFile(const AudioTask &task);
 	void processNextTask();
 	void applyDucking(bool active);
 
+	// 双缓冲：主源与备用源交替播放，当前片段播放时在空闲源中预载下一段
+	bool isDoubleBuffered() const;
+	QString slotSourceName(int slot) const;
+	bool startPreroll();
+	void prerollNextTask();
+	void cancelPreroll();
+
+	// 媒体源信号：在 OBS 线程触发，转投到控制器线程处理
+	enum MediaEvent { MediaStarted, MediaEnded, MediaStopped };
+	struct MediaSlot {
+		AudioController *owner = nullptr;
+		int index = 0;
+		struct obs_weak_source *signalSource = nullptr;
+		// 每装载一个新文件递增，用于丢弃上一个文件迟到的媒体事件
+		std::atomic<quint64> generation{0};
+	};
+	static void onMediaStartedSignal(void *data, struct calldata *cd);
+	static void onMediaEndedSignal(void *data, struct calldata *cd);
+	static void onMediaStoppedSignal(void *data, struct calldata *cd);
+	void postMediaEvent(int slot, MediaEvent event);
+	void handleMediaEvent(int slot, MediaEvent event, quint64 generation);
+	void attachMediaSignals(int slot, struct obs_source *source);
+	void detachMediaSignals(int slot);
+	void onSourceRenamed(const QString &prevName, const QString &newName);
+
 	QString pickRandomFile(const QString &path, bool useHistory = false);
 	double getAudioDuration(const QString &filePath);
-	void cleanUpOldTempFiles(qint64 currentPlayingTs = 0);
-
-	// 声明合并函数
-	QString mergeWavFiles(const QStringList &files);
+	void cleanUpOldTempFiles();
 
 	int getNoiseFileCount();
 	void resetTimeTrigger();
 	void resetNoiseTrigger();
 
-	PluginConfig m_config;
-	QList<AudioTask> m_queue;
+	// 控制器线程持有的配置快照，只在本线程替换；其他线程请用 ConfigStore::snapshot()
+	std::shared_ptr<const PluginConfig> m_config;
+	TaskQueue m_queue;
 
-	bool m_isPlaying = false;
+	std::atomic<bool> m_isPlaying{false};
 	QString m_currentJobType = "";
+	QString m_currentFile;
 	qint64 m_playStartTime = 0;
+	qint64 m_playStartMicros = 0; // 打开延迟的起点 (单调时钟)
+	qint64 m_currentAddTime = 0;
+
+	MediaSlot m_slots[2];
+	int m_activeSlot = 0;
+	bool m_mediaStarted = false;
+
+	bool m_prerollActive = false;
+	AudioTask m_prerollTask;
 
 	qint64 m_nextTimeTrigger = 0;
 	qint64 m_nextNoiseTrigger = 0;
-	qint64 m_lastHeartbeatTime = 0;
+	std::atomic<qint64> m_lastHeartbeatTime{0};
 
+	// 噪音抽取的去重历史，HTTP 线程与后台线程都会访问，单独一把小锁
 	QList<QString> m_history;
-	QMap<QString, float> m_originalVolumes;
+	QMutex m_historyMutex;
+
+	std::shared_ptr<const StatusSnapshot> m_status;
+	QString m_voiceNamePath; // 仅在语音包路径变化时重新取目录名
+	QString m_voiceName;
+
+	static constexpr int kMaxDecisions = 128;
+	QList<SchedulerDecision> m_decisions;
+	mutable QMutex m_decisionMutex;
+	SourceCache *m_sources;
+	VoicePackIndex *m_voiceIndex;
+	TimeAnnouncementCache *m_timeCache;
+	qint64 m_lastPrebuildMinute = 0;
+	DuckingEngine *m_ducking;
+
+	QThread *m_ioThread;
+	QObject *m_ioContext;
 
 	QTimer *m_mainTimer;
 	QTimer *m_playbackMonitorTimer;
-	QMutex m_mutex;
 };
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <QString>
 #include <QStringList>
 #include <QList>
+#include <QMetaType>
 
 extern "C" {
 #include <obs-module.h>
@@ -10,6 +11,7 @@ extern "C" {
 struct PluginConfig {
 	bool scriptEnabled = true;
 	QString mediaSourceName = "";
+	QString secondaryMediaSourceName = ""; // 预载用备用媒体源，留空则不启用双缓冲
 	QString voicePackPath = "";
 
 	// 报时设置
@@ -24,7 +26,45 @@ struct PluginConfig {
 	int historySize = 30;        // 去重轮数
 	int shortFileThreshold = 6; // 连播阈值(秒)
 
+	// 报时缓存：预生成未来 N 分钟的报时音频，最多保留 capacity 个文件
+	int timeCacheMinutes = 3;
+	int timeCacheCapacity = 64;
+
 	// 闪避设置
 	QStringList duckSources;
 	float duckVolume = 0.0f;
-};
\ No newline at end of file
+	int duckAttackMs = 200;  // 压低渐变时长
+	int duckReleaseMs = 600; // 恢复渐变时长
+	int duckCurve = 1;       // 0 线性, 1 S 曲线, 2 dB 线性
+	int duckLeadMs = 150;    // 空闲时先开始压低，再延后这么久开播
+
+	// 调度策略
+	bool replyFirst = true;      // 回复任务插到暖场 (noise) 之前
+	bool replyPreempt = false;   // 回复到达时打断正在播放的暖场 (需开启 replyFirst)
+	int replyDeadlineMs = 20000; // 各类任务最长排队时间，超时丢弃，0 为不限
+	int timeDeadlineMs = 30000;
+	int noiseDeadlineMs = 0;
+
+	// HTTP 服务限制 (监听地址修改后需重新加载插件生效)
+	QString httpBindAddress = "0.0.0.0";
+	int httpMaxConnections = 32; // 0 为不限
+	int httpMaxHeaderBytes = 16 * 1024;
+	int httpMaxBodyBytes = 256 * 1024;
+	int httpIdleTimeoutMs = 15000; // 长连接两次请求之间的最长空闲，0 为不限
+	int httpReadTimeoutMs = 5000;  // 单个请求从开始到接收完整的最长时间，0 为不限
+	double httpRatePerSecond = 20.0; // 每个客户端 IP 的令牌桶速率与容量，速率为 0 时不限流
+	int httpRateBurst = 40;
+	QString httpCorsOrigin = "*";
+
+	// /play 去重：相同 request_id 在 TTL 内、相同路径在窗口内只入队一次，0 为关闭
+	int requestIdTtlMs = 60000;
+	int dedupWindowMs = 1500;
+};
+Q_DECLARE_METATYPE(PluginConfig)
+
+// 任务结构体
+struct AudioTask {
+	QString filePath;
+	QString type;   // "time", "noise", "reply"
+	qint64 addTime = 0; // 🎯 新增：记录入队时间戳 (毫秒)，用于超时判断
+};
@@ -1,13 +1,10 @@
 ﻿#include "ConfigDialog.h"
 #include "ui_ConfigDialog.h"
 #include "AudioController.h"
+#include "PcmAudioSource.h"
 
 #include <QFileDialog>
 #include <QListWidgetItem>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QFile>
 #include <QDir>
 #include <QDebug>
 #include <QAbstractItemView>
@@ -61,6 +58,9 @@ ConfigDialog::ConfigDialog(QWidget *parent) : QDialog(parent), ui(new Ui::Config
 	ui->comboMediaSource->setStyleSheet(comboStyle);
 	ui->comboMediaSource->setView(new QListView());
 
+	ui->comboSecondarySource->setStyleSheet(comboStyle);
+	ui->comboSecondarySource->setView(new QListView());
+
 	ui->comboAddDuckSource->setStyleSheet(comboStyle);
 	ui->comboAddDuckSource->setView(new QListView());
 
@@ -189,9 +189,11 @@ void ConfigDialog::addDuckTag(const QString &sourceName)
 void ConfigDialog::refreshObsSources()
 {
 	ui->comboMediaSource->clear();
+	ui->comboSecondarySource->clear();
 	ui->comboAddDuckSource->clear();
 
 	ui->comboMediaSource->addItem(QString::fromUtf8("-- 请选择媒体源 --"));
+	ui->comboSecondarySource->addItem(QString::fromUtf8("-- 不启用预载 --"));
 	ui->comboAddDuckSource->addItem(QString::fromUtf8("-- 点击添加音频源 --"));
 
 	auto enumProc = [](void *data, obs_source_t *source) {
@@ -200,8 +202,10 @@ void ConfigDialog::refreshObsSources()
 		const char *id = obs_source_get_id(source);
 		uint32_t flags = obs_source_get_output_flags(source);
 
-		if (strcmp(id, "ffmpeg_source") == 0 || strcmp(id, "vlc_source") == 0) {
+		if (strcmp(id, "ffmpeg_source") == 0 || strcmp(id, "vlc_source") == 0 ||
+		    strcmp(id, XHS_PCM_SOURCE_ID) == 0) {
 			self->ui->comboMediaSource->addItem(QString::fromUtf8(name));
+			self->ui->comboSecondarySource->addItem(QString::fromUtf8(name));
 		}
 		if (flags & OBS_SOURCE_AUDIO) {
 			self->ui->comboAddDuckSource->addItem(QString::fromUtf8(name));
@@ -219,6 +223,10 @@ void ConfigDialog::loadConfig()
 	if (mediaIdx != -1)
 		ui->comboMediaSource->setCurrentIndex(mediaIdx);
 
+	int secondaryIdx = ui->comboSecondarySource->findText(cfg.secondaryMediaSourceName);
+	if (secondaryIdx != -1)
+		ui->comboSecondarySource->setCurrentIndex(secondaryIdx);
+
 	ui->editVoicePath->setText(cfg.voicePackPath);
 	ui->spinTimeMin->setValue(cfg.timeMin);
 	ui->spinTimeMax->setValue(cfg.timeMax);
@@ -239,6 +247,9 @@ void ConfigDialog::loadConfig()
 
 	ui->sliderDuckVol->setValue(static_cast<int>(cfg.duckVolume * 100));
 	ui->lblVolVal->setText(QString::number(ui->sliderDuckVol->value()) + "%");
+
+	ui->spinDuckAttack->setValue(cfg.duckAttackMs);
+	ui->spinDuckRelease->setValue(cfg.duckReleaseMs);
 }
 
 void ConfigDialog::handleBrowseClicked()
@@ -262,12 +273,17 @@ void ConfigDialog::handleAccepted()
 
 void ConfigDialog::saveConfig()
 {
-	PluginConfig cfg;
+	// 以当前配置为底，保留对话框中没有的高级选项
+	PluginConfig cfg = AudioController::instance().getConfig();
 
 	cfg.mediaSourceName = ui->comboMediaSource->currentText();
 	if (cfg.mediaSourceName.contains("--"))
 		cfg.mediaSourceName = "";
 
+	cfg.secondaryMediaSourceName = ui->comboSecondarySource->currentText();
+	if (cfg.secondaryMediaSourceName.contains("--") || cfg.secondaryMediaSourceName == cfg.mediaSourceName)
+		cfg.secondaryMediaSourceName = "";
+
 	cfg.voicePackPath = ui->editVoicePath->text();
 	cfg.timeMin = ui->spinTimeMin->value();
 	cfg.timeMax = ui->spinTimeMax->value();
@@ -278,6 +294,8 @@ void ConfigDialog::saveConfig()
 	cfg.shortFileThreshold = ui->spinShortThreshold->value();
 
 	cfg.duckVolume = ui->sliderDuckVol->value() / 100.0f;
+	cfg.duckAttackMs = ui->spinDuckAttack->value();
+	cfg.duckReleaseMs = ui->spinDuckRelease->value();
 
 	cfg.duckSources.clear();
 	for (int i = 0; i < ui->listDuckTags->count(); ++i) {
@@ -289,38 +307,6 @@ void ConfigDialog::saveConfig()
 		}
 	}
 
+	// 校验并原子写盘由 ConfigStore 完成
 	AudioController::instance().setConfig(cfg);
-
-	QJsonObject root;
-	root["mediaSourceName"] = cfg.mediaSourceName;
-	root["voicePackPath"] = cfg.voicePackPath;
-	root["timeMin"] = cfg.timeMin;
-	root["timeMax"] = cfg.timeMax;
-	root["noiseMin"] = cfg.noiseMin;
-	root["noiseMax"] = cfg.noiseMax;
-	root["historySize"] = cfg.historySize;
-	root["shortFileThreshold"] = cfg.shortFileThreshold;
-	root["duckVolume"] = static_cast<double>(cfg.duckVolume);
-
-	QJsonArray sourcesArray;
-	for (const QString &s : cfg.duckSources)
-		sourcesArray.append(s);
-	root["duckSources"] = sourcesArray;
-
-	QString path = getConfigPath();
-	QDir().mkpath(QFileInfo(path).absolutePath());
-	QFile file(path);
-	if (file.open(QIODevice::WriteOnly)) {
-		file.write(QJsonDocument(root).toJson());
-		file.close();
-	}
 }
-
-QString ConfigDialog::getConfigPath()
-{
-	char *path_c = obs_module_config_path("xhs-guard-config.json");
-	QString path = QString::fromUtf8(path_c);
-	if (path_c)
-		bfree(path_c);
-	return path;
-}
\ No newline at end of file
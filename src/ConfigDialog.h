@@ -26,7 +26,6 @@ private:
 	void refreshObsSources(); // 刷新并过滤 OBS 来源
 	void loadConfig();        // 将内存配置加载到 UI
 	void saveConfig();        // 将 UI 配置保存到内存和文件
-	QString getConfigPath();  // 获取 JSON 路径
 
 	// 🎯 新增：添加标签辅助函数
 	void addDuckTag(const QString &sourceName);
@@ -0,0 +1,300 @@
+﻿#include "ConfigStore.h"
+#include "EventLog.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QJsonDocument>
+#include <QJsonArray>
+
+extern "C" {
+#include <obs-module.h>
+}
+
+// 编辑器保存文件时常常先截断再写入，等写完再读
+static const int kReloadDelayMs = 300;
+static const int kMinHttpTimeoutMs = 1000;
+
+ConfigStore &ConfigStore::instance()
+{
+	static ConfigStore inst;
+	return inst;
+}
+
+ConfigStore::ConfigStore() : m_config(std::make_shared<PluginConfig>())
+{
+	m_watcher = new QFileSystemWatcher(this);
+	connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &ConfigStore::onWatchedPathChanged);
+	connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &ConfigStore::onWatchedPathChanged);
+
+	m_reloadTimer = new QTimer(this);
+	m_reloadTimer->setSingleShot(true);
+	m_reloadTimer->setInterval(kReloadDelayMs);
+	connect(m_reloadTimer, &QTimer::timeout, this, &ConfigStore::reloadFromDisk);
+}
+
+ConfigStore::~ConfigStore() {}
+
+QString ConfigStore::defaultPath()
+{
+	char *path_c = obs_module_config_path("xhs-guard-config.json");
+	QString path = QString::fromUtf8(path_c);
+	if (path_c)
+		bfree(path_c);
+	return path;
+}
+
+void ConfigStore::open(const QString &path)
+{
+	m_path = path;
+	if (m_path.isEmpty())
+		return;
+
+	QDir().mkpath(QFileInfo(m_path).absolutePath());
+
+	QFile file(m_path);
+	if (file.open(QIODevice::ReadOnly)) {
+		QByteArray content = file.readAll();
+		QJsonDocument doc = QJsonDocument::fromJson(content);
+		if (!doc.isNull()) {
+			m_lastContent = content;
+			publish(fromJson(doc.object()));
+		}
+	}
+
+	// 同时监视所在目录：原子替换后旧的文件监视会失效，需要重新挂上
+	m_watcher->addPath(QFileInfo(m_path).absolutePath());
+	watchFile();
+}
+
+void ConfigStore::save(const PluginConfig &config)
+{
+	PluginConfig cfg = validated(config);
+	publish(cfg);
+
+	if (m_path.isEmpty())
+		return;
+
+	QByteArray content = QJsonDocument(toJson(cfg)).toJson();
+	if (content == m_lastContent)
+		return;
+
+	QDir().mkpath(QFileInfo(m_path).absolutePath());
+	QSaveFile file(m_path);
+	if (!file.open(QIODevice::WriteOnly)) {
+		blog(LOG_WARNING, "[智播精灵] 无法写入配置文件: %s", m_path.toUtf8().constData());
+		return;
+	}
+	file.write(content);
+	if (!file.commit()) {
+		blog(LOG_WARNING, "[智播精灵] 配置文件保存失败: %s", m_path.toUtf8().constData());
+		return;
+	}
+	m_lastContent = content;
+	watchFile();
+}
+
+void ConfigStore::publish(const PluginConfig &config)
+{
+	std::atomic_store(&m_config, std::shared_ptr<const PluginConfig>(std::make_shared<PluginConfig>(config)));
+	emit changed();
+}
+
+void ConfigStore::watchFile()
+{
+	if (QFile::exists(m_path) && !m_watcher->files().contains(m_path))
+		m_watcher->addPath(m_path);
+}
+
+void ConfigStore::onWatchedPathChanged()
+{
+	m_reloadTimer->start();
+}
+
+void ConfigStore::reloadFromDisk()
+{
+	watchFile();
+
+	QFile file(m_path);
+	if (!file.open(QIODevice::ReadOnly))
+		return;
+	QByteArray content = file.readAll();
+	if (content == m_lastContent)
+		return;
+
+	// 写到一半或手写出错的文件不覆盖当前配置，等下一次修改
+	QJsonDocument doc = QJsonDocument::fromJson(content);
+	if (doc.isNull() || !doc.isObject()) {
+		blog(LOG_WARNING, "[智播精灵] 配置文件格式错误，已忽略本次修改");
+		return;
+	}
+	m_lastContent = content;
+
+	PluginConfig cfg = fromJson(doc.object());
+	// 总开关只在运行期有效，不随文件重新加载而改变
+	cfg.scriptEnabled = snapshot()->scriptEnabled;
+	publish(cfg);
+	EventLog::instance().post(LogEvent::ConfigReloaded, m_path);
+}
+
+PluginConfig ConfigStore::validated(PluginConfig config)
+{
+	// QRandomGenerator::bounded 要求下限不大于上限
+	config.timeMin = qMax(1, config.timeMin);
+	config.timeMax = qMax(1, config.timeMax);
+	if (config.timeMin > config.timeMax)
+		std::swap(config.timeMin, config.timeMax);
+	config.noiseMin = qMax(1, config.noiseMin);
+	config.noiseMax = qMax(1, config.noiseMax);
+	if (config.noiseMin > config.noiseMax)
+		std::swap(config.noiseMin, config.noiseMax);
+
+	config.historySize = qMax(0, config.historySize);
+	config.shortFileThreshold = qMax(0, config.shortFileThreshold);
+	config.timeCacheMinutes = qMax(0, config.timeCacheMinutes);
+	config.timeCacheCapacity = qMax(1, config.timeCacheCapacity);
+
+	config.duckVolume = qBound(0.0f, config.duckVolume, 1.0f);
+	config.duckAttackMs = qMax(0, config.duckAttackMs);
+	config.duckReleaseMs = qMax(0, config.duckReleaseMs);
+	config.duckCurve = qBound(0, config.duckCurve, 2);
+	config.duckLeadMs = qMax(0, config.duckLeadMs);
+
+	config.replyDeadlineMs = qMax(0, config.replyDeadlineMs);
+	config.timeDeadlineMs = qMax(0, config.timeDeadlineMs);
+	config.noiseDeadlineMs = qMax(0, config.noiseDeadlineMs);
+
+	// 连接数和两个超时都以 0 表示不限；超时设了就至少 1 秒，避免连接刚建立就被关掉
+	config.httpMaxConnections = qMax(0, config.httpMaxConnections);
+	config.httpMaxHeaderBytes = qMax(1024, config.httpMaxHeaderBytes);
+	config.httpMaxBodyBytes = qMax(0, config.httpMaxBodyBytes);
+	config.httpIdleTimeoutMs = config.httpIdleTimeoutMs > 0 ? qMax(kMinHttpTimeoutMs, config.httpIdleTimeoutMs) : 0;
+	config.httpReadTimeoutMs = config.httpReadTimeoutMs > 0 ? qMax(kMinHttpTimeoutMs, config.httpReadTimeoutMs) : 0;
+	config.httpRatePerSecond = qMax(0.0, config.httpRatePerSecond);
+	config.httpRateBurst = qMax(1, config.httpRateBurst);
+
+	config.requestIdTtlMs = qMax(0, config.requestIdTtlMs);
+	config.dedupWindowMs = qMax(0, config.dedupWindowMs);
+
+	config.duckSources.removeAll(QString());
+	config.duckSources.removeDuplicates();
+	return config;
+}
+
+PluginConfig ConfigStore::fromJson(const QJsonObject &root)
+{
+	PluginConfig config;
+
+	config.mediaSourceName = root["mediaSourceName"].toString();
+	config.secondaryMediaSourceName = root["secondaryMediaSourceName"].toString();
+	config.voicePackPath = root["voicePackPath"].toString();
+	config.timeMin = root["timeMin"].toInt(120);
+	config.timeMax = root["timeMax"].toInt(180);
+	config.noiseMin = root["noiseMin"].toInt(90);
+	config.noiseMax = root["noiseMax"].toInt(120);
+	config.duckVolume = root["duckVolume"].toDouble(0.2);
+	if (root.contains("duckAttackMs"))
+		config.duckAttackMs = root["duckAttackMs"].toInt(200);
+	if (root.contains("duckReleaseMs"))
+		config.duckReleaseMs = root["duckReleaseMs"].toInt(600);
+	if (root.contains("duckCurve"))
+		config.duckCurve = root["duckCurve"].toInt(1);
+	if (root.contains("duckLeadMs"))
+		config.duckLeadMs = root["duckLeadMs"].toInt(150);
+
+	if (root.contains("replyFirst"))
+		config.replyFirst = root["replyFirst"].toBool(true);
+	if (root.contains("replyPreempt"))
+		config.replyPreempt = root["replyPreempt"].toBool(false);
+	if (root.contains("replyDeadlineMs"))
+		config.replyDeadlineMs = root["replyDeadlineMs"].toInt(20000);
+	if (root.contains("timeDeadlineMs"))
+		config.timeDeadlineMs = root["timeDeadlineMs"].toInt(30000);
+	if (root.contains("noiseDeadlineMs"))
+		config.noiseDeadlineMs = root["noiseDeadlineMs"].toInt(0);
+
+	if (root.contains("httpBindAddress"))
+		config.httpBindAddress = root["httpBindAddress"].toString("0.0.0.0");
+	if (root.contains("httpMaxConnections"))
+		config.httpMaxConnections = root["httpMaxConnections"].toInt(32);
+	if (root.contains("httpMaxHeaderBytes"))
+		config.httpMaxHeaderBytes = root["httpMaxHeaderBytes"].toInt(16 * 1024);
+	if (root.contains("httpMaxBodyBytes"))
+		config.httpMaxBodyBytes = root["httpMaxBodyBytes"].toInt(256 * 1024);
+	if (root.contains("httpIdleTimeoutMs"))
+		config.httpIdleTimeoutMs = root["httpIdleTimeoutMs"].toInt(15000);
+	if (root.contains("httpReadTimeoutMs"))
+		config.httpReadTimeoutMs = root["httpReadTimeoutMs"].toInt(5000);
+	if (root.contains("httpRatePerSecond"))
+		config.httpRatePerSecond = root["httpRatePerSecond"].toDouble(20.0);
+	if (root.contains("httpRateBurst"))
+		config.httpRateBurst = root["httpRateBurst"].toInt(40);
+	if (root.contains("httpCorsOrigin"))
+		config.httpCorsOrigin = root["httpCorsOrigin"].toString("*");
+
+	if (root.contains("requestIdTtlMs"))
+		config.requestIdTtlMs = root["requestIdTtlMs"].toInt(60000);
+	if (root.contains("dedupWindowMs"))
+		config.dedupWindowMs = root["dedupWindowMs"].toInt(1500);
+
+	if (root.contains("historySize"))
+		config.historySize = root["historySize"].toInt(30);
+	if (root.contains("shortFileThreshold"))
+		config.shortFileThreshold = root["shortFileThreshold"].toInt(6);
+	if (root.contains("timeCacheMinutes"))
+		config.timeCacheMinutes = root["timeCacheMinutes"].toInt(3);
+	if (root.contains("timeCacheCapacity"))
+		config.timeCacheCapacity = root["timeCacheCapacity"].toInt(64);
+
+	QJsonArray arr = root["duckSources"].toArray();
+	for (const auto &val : arr) {
+		config.duckSources.append(val.toString());
+	}
+
+	return validated(config);
+}
+
+QJsonObject ConfigStore::toJson(const PluginConfig &cfg)
+{
+	QJsonObject root;
+	root["mediaSourceName"] = cfg.mediaSourceName;
+	root["secondaryMediaSourceName"] = cfg.secondaryMediaSourceName;
+	root["voicePackPath"] = cfg.voicePackPath;
+	root["timeMin"] = cfg.timeMin;
+	root["timeMax"] = cfg.timeMax;
+	root["noiseMin"] = cfg.noiseMin;
+	root["noiseMax"] = cfg.noiseMax;
+	root["historySize"] = cfg.historySize;
+	root["shortFileThreshold"] = cfg.shortFileThreshold;
+	root["timeCacheMinutes"] = cfg.timeCacheMinutes;
+	root["timeCacheCapacity"] = cfg.timeCacheCapacity;
+	root["duckVolume"] = static_cast<double>(cfg.duckVolume);
+	root["duckAttackMs"] = cfg.duckAttackMs;
+	root["duckReleaseMs"] = cfg.duckReleaseMs;
+	root["duckCurve"] = cfg.duckCurve;
+	root["duckLeadMs"] = cfg.duckLeadMs;
+	root["replyFirst"] = cfg.replyFirst;
+	root["replyPreempt"] = cfg.replyPreempt;
+	root["replyDeadlineMs"] = cfg.replyDeadlineMs;
+	root["timeDeadlineMs"] = cfg.timeDeadlineMs;
+	root["noiseDeadlineMs"] = cfg.noiseDeadlineMs;
+	root["httpBindAddress"] = cfg.httpBindAddress;
+	root["httpMaxConnections"] = cfg.httpMaxConnections;
+	root["httpMaxHeaderBytes"] = cfg.httpMaxHeaderBytes;
+	root["httpMaxBodyBytes"] = cfg.httpMaxBodyBytes;
+	root["httpIdleTimeoutMs"] = cfg.httpIdleTimeoutMs;
+	root["httpReadTimeoutMs"] = cfg.httpReadTimeoutMs;
+	root["httpRatePerSecond"] = cfg.httpRatePerSecond;
+	root["httpRateBurst"] = cfg.httpRateBurst;
+	root["httpCorsOrigin"] = cfg.httpCorsOrigin;
+	root["requestIdTtlMs"] = cfg.requestIdTtlMs;
+	root["dedupWindowMs"] = cfg.dedupWindowMs;
+
+	QJsonArray sourcesArray;
+	for (const QString &s : cfg.duckSources)
+		sourcesArray.append(s);
+	root["duckSources"] = sourcesArray;
+	return root;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <QObject>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <memory>
+#include "Common.h"
+
+class QFileSystemWatcher;
+class QTimer;
+
+// 插件配置的唯一来源：校验后以不可变快照发布，任意线程无锁读取
+// 写盘走临时文件 + 原子替换；配置文件被外部修改时自动重新加载
+// snapshot 可在任意线程调用，open/save 只在界面线程调用
+class ConfigStore : public QObject {
+	Q_OBJECT
+public:
+	static ConfigStore &instance();
+
+	static QString defaultPath();
+
+	// 读取配置文件并开始监视其变化
+	void open(const QString &path);
+
+	std::shared_ptr<const PluginConfig> snapshot() const { return std::atomic_load(&m_config); }
+
+	// 校验、发布并写盘，内容与磁盘上一致时不重复写
+	void save(const PluginConfig &config);
+
+	// 修正越界或互相矛盾的取值，例如 timeMin > timeMax 时交换
+	static PluginConfig validated(PluginConfig config);
+	static PluginConfig fromJson(const QJsonObject &root);
+	static QJsonObject toJson(const PluginConfig &config);
+
+signals:
+	// 新快照发布后发出，接收方通过 snapshot() 读取
+	void changed();
+
+private slots:
+	void onWatchedPathChanged();
+	void reloadFromDisk();
+
+private:
+	ConfigStore();
+	~ConfigStore();
+
+	void publish(const PluginConfig &config);
+	void watchFile();
+
+	std::shared_ptr<const PluginConfig> m_config;
+
+	QString m_path;
+	QByteArray m_lastContent; // 最近一次读到或写出的文件内容，用于忽略自己写盘触发的通知
+	QFileSystemWatcher *m_watcher;
+	QTimer *m_reloadTimer;
+};
@@ -8,7 +8,7 @@
 #include <QCheckBox>
 #include <QToolButton>
 #include <QLabel>
-#include <QTextEdit>
+#include <QPlainTextEdit>
 #include <QTimer>
 #include <QMainWindow>
 #include <QPainter>
@@ -201,7 +201,7 @@ Dashboard::Dashboard(QWidget *parent) : QDockWidget(parent), ui(new Ui::Dashboar
 		}
 
 		/* --- 日志框 --- */
-		QTextEdit#logBox {
+		QPlainTextEdit#logBox {
 			background-color: #09090b;
 			border: 1px solid #27272a;
 			border-radius: 6px;
@@ -231,14 +231,35 @@ Dashboard::Dashboard(QWidget *parent) : QDockWidget(parent), ui(new Ui::Dashboar
 	ui->masterSwitch->setIconSize(QSize(46, 20));
 	ui->masterSwitch->setIcon(iconOff);
 
-	ui->btnTriggerTime->setIcon(QIcon(drawIcon(Icon_Plane, COL_GRAY, 16)));
+	warmIconCache();
+	ui->btnTriggerTime->setIcon(QIcon(cachedIcon(Icon_Plane, COL_GRAY, 16)));
 	ui->btnTriggerTime->setIconSize(QSize(16, 16));
-	ui->btnTriggerNoise->setIcon(QIcon(drawIcon(Icon_Plane, COL_GRAY, 16)));
+	ui->btnTriggerNoise->setIcon(QIcon(cachedIcon(Icon_Plane, COL_GRAY, 16)));
 	ui->btnTriggerNoise->setIconSize(QSize(16, 16));
 
+	// 固定不变的局部样式只设置一次，避免每秒重新 polish 整个停靠栏
+	QString subLabelStyle =
+		"font-size: 11px; color: #a1a1aa; border: none; qproperty-alignment: AlignBottom | AlignHCenter; margin-bottom: 12px;";
+	ui->lblTitleTime->setStyleSheet(subLabelStyle);
+	ui->lblTitleNoise->setStyleSheet(subLabelStyle);
+
+	QString infoStyle = "font-size: 10px; color: #a1a1aa; border: none;";
+	ui->lblInfo1->setStyleSheet(infoStyle);
+	ui->lblInfo2->setStyleSheet(infoStyle);
+	ui->stSub->setStyleSheet("font-size: 11px; color: #a1a1aa; border: none;");
+
+	// 日志框：限制总行数，长时间直播内存不再增长
+	ui->logBox->setMaximumBlockCount(kMaxLogLines);
+	ui->logBox->setUndoRedoEnabled(false);
+
+	m_logFlushTimer = new QTimer(this);
+	m_logFlushTimer->setSingleShot(true);
+	m_logFlushTimer->setInterval(kLogFlushMs);
+	connect(m_logFlushTimer, &QTimer::timeout, this, &Dashboard::flushLogs);
+
 	// === 4. 信号绑定 ===
-	connect(&AudioController::instance(), &AudioController::statusUpdated, this, &Dashboard::onStatusUpdated);
-	connect(&AudioController::instance(), &AudioController::logMessage, this, &Dashboard::onLogMessage);
+	connect(&AudioController::instance(), &AudioController::statusChanged, this, &Dashboard::onStatusChanged);
+	connect(&EventLog::instance(), &EventLog::eventsReady, this, &Dashboard::onLogEvents);
 
 	connect(ui->masterSwitch, &QCheckBox::toggled, this, [this, iconOn, iconOff](bool checked) {
 		PluginConfig cfg = AudioController::instance().getConfig();
@@ -254,14 +275,49 @@ Dashboard::Dashboard(QWidget *parent) : QDockWidget(parent), ui(new Ui::Dashboar
 
 	connect(ui->btnSettings, &QToolButton::clicked, this, &Dashboard::showConfigDialog);
 
+	m_countdownTimer = new QTimer(this);
+	connect(m_countdownTimer, &QTimer::timeout, this, &Dashboard::refreshStatus);
+	m_countdownTimer->start(1000);
+
 	// 初始刷新
 	updateConnectionState(false);
+	applyEnabled(false);
 	updateStyles("disabled", false);
+	onStatusChanged();
 }
 
 Dashboard::~Dashboard() {}
 
-QPixmap Dashboard::drawIcon(IconType type, const QColor &color, int size)
+QPixmap Dashboard::cachedIcon(IconType type, const QColor &color, int size)
+{
+	qreal dpr = devicePixelRatioF();
+	// 键：图标 8 位 | DPR×4 8 位 | 尺寸 16 位 | RGBA 32 位
+	quint64 key = (quint64(type) & 0xff) << 56 | (quint64(qRound(dpr * 4)) & 0xff) << 48 |
+		      (quint64(size) & 0xffff) << 32 | quint64(color.rgba());
+	auto it = m_iconCache.constFind(key);
+	if (it != m_iconCache.constEnd())
+		return *it;
+
+	QPixmap pixmap = drawIcon(type, color, size, dpr);
+	m_iconCache.insert(key, pixmap);
+	return pixmap;
+}
+
+void Dashboard::warmIconCache()
+{
+	// 预先生成各状态会用到的全部组合
+	for (const QColor &c : {COL_GRAY, COL_CYAN, COL_AMBER})
+		cachedIcon(Icon_Plane, c, 16);
+	for (const QColor &c : {COL_GRAY, COL_GREEN})
+		cachedIcon(Icon_Link, c, 22);
+	for (const QColor &c : {COL_CYAN, COL_AMBER, COL_PINK})
+		cachedIcon(Icon_Play, c, 17);
+	for (const QColor &c : {COL_GRAY, COL_GREEN})
+		cachedIcon(Icon_Circle, c, 17);
+	cachedIcon(Icon_Stop, COL_GRAY, 17);
+}
+
+QPixmap Dashboard::drawIcon(IconType type, const QColor &color, int size, qreal dpr)
 {
 	QString resourcePath;
 	switch (type) {
@@ -291,7 +347,9 @@ QPixmap Dashboard::drawIcon(IconType type, const QColor &color, int size)
 	if (src.isNull())
 		return QPixmap(size, size);
 
-	QPixmap dest(size * 2, size * 2);
+	// 逻辑尺寸保持 2 倍，高分屏上按 DPR 提高像素密度
+	int pixels = qRound(size * 2 * dpr);
+	QPixmap dest(pixels, pixels);
 	dest.fill(Qt::transparent);
 
 	QPainter p(&dest);
@@ -303,12 +361,13 @@ QPixmap Dashboard::drawIcon(IconType type, const QColor &color, int size)
 		p.translate(-size, -size);
 	}
 
-	QRect targetRect(0, 0, size * 2, size * 2);
+	QRect targetRect(0, 0, pixels, pixels);
 	p.drawPixmap(targetRect, src);
 	p.setCompositionMode(QPainter::CompositionMode_SourceIn);
 	p.fillRect(targetRect, color);
 	p.end();
 
+	dest.setDevicePixelRatio(dpr);
 	return dest;
 }
 
@@ -316,38 +375,119 @@ void Dashboard::updateConnectionState(bool isConnected)
 {
 	int size = 22;
 	if (isConnected) {
-		ui->iconLink->setPixmap(drawIcon(Icon_Link, COL_GREEN, size));
+		ui->iconLink->setPixmap(cachedIcon(Icon_Link, COL_GREEN, size));
 
 		// 【修改点】不再设置 lblConnText，而是设置图标的悬停提示
 		ui->iconLink->setToolTip(QString::fromUtf8("直播中控台已连接"));
 	} else {
-		ui->iconLink->setPixmap(drawIcon(Icon_Link, COL_GRAY, size));
+		ui->iconLink->setPixmap(cachedIcon(Icon_Link, COL_GRAY, size));
 
 		// 【修改点】同上，设置为未连接的提示
 		ui->iconLink->setToolTip(QString::fromUtf8("直播中控台未连接"));
 	}
 }
 
-void Dashboard::onStatusUpdated(const QString &type, const QString &msg, qint64 tNext, qint64 nNext, bool isConnected,
-				int noiseCount, const QString &voiceName)
+void Dashboard::onStatusChanged()
 {
-	updateConnectionState(isConnected);
+	m_status = AudioController::instance().statusSnapshot();
+	refreshStatus();
+}
+
+void Dashboard::refreshStatus()
+{
+	if (!m_status)
+		return;
+
+	const StatusSnapshot &status = *m_status;
+	const QString &type = status.type;
+	bool enabled = status.enabled;
+	qint64 now = QDateTime::currentSecsSinceEpoch();
+
+	DashboardViewModel vm;
+	vm.connected = status.connected;
+	vm.enabled = enabled;
+	vm.styleType = enabled ? type : "disabled";
+
+	// 1. 倒计时数字
+	if (enabled) {
+		qint64 tNext = status.nextTimeTrigger - now;
+		qint64 nNext = status.nextNoiseTrigger - now;
+		vm.timeText = QString("%1s").arg(tNext > 0 ? tNext : 0);
+		vm.noiseText = QString("%1s").arg(nNext > 0 ? nNext : 0);
+	} else {
+		vm.timeText = "--";
+		vm.noiseText = "--";
+	}
+
+	vm.info1 = QString::fromUtf8("插播音色: %1").arg(status.voiceName);
+	vm.info2 = status.noiseFileCount < 0 ? QString::fromUtf8("混淆素材库: 索引中…")
+					     : QString::fromUtf8("混淆素材库: %1个文件").arg(status.noiseFileCount);
+
+	// 2. 状态卡片内容
+	QString queueSuffix = status.queueDepth > 0 ? QString(" (+%1)").arg(status.queueDepth) : QString(" (0)");
+
+	if (!enabled) {
+		vm.title = QString::fromUtf8("已关闭");
+		vm.sub = QString::fromUtf8("智播已停止工作");
+	} else {
+		if (type == "playing_time") {
+			vm.title = QString::fromUtf8("正在报时");
+			vm.sub = QString::fromUtf8("当前播放队列") + queueSuffix;
+		} else if (type == "playing_noise") {
+			vm.title = QString::fromUtf8("正在播放混淆");
+			vm.sub = QString::fromUtf8("当前播放队列") + queueSuffix;
+		} else if (type == "playing_reply") {
+			vm.title = QString::fromUtf8("正在智能回复");
+			vm.sub = QString::fromUtf8("当前播放队列") + queueSuffix;
+		} else {
+			vm.title = QString::fromUtf8("监控中");
+			vm.sub = QString::fromUtf8("正在监控直播间...");
+		}
+	}
+
+	render(vm);
+}
 
-	bool enabled = AudioController::instance().getConfig().scriptEnabled;
+void Dashboard::render(const DashboardViewModel &vm)
+{
+	// 与上次渲染结果逐项比较，文字变化只 setText，样式和图标只在状态切换时重设
+	bool first = !m_hasRendered;
+	const DashboardViewModel &old = m_rendered;
+
+	if (first || vm.connected != old.connected)
+		updateConnectionState(vm.connected);
+	if (first || vm.enabled != old.enabled)
+		applyEnabled(vm.enabled);
+	if (first || vm.timeText != old.timeText)
+		ui->tVal->setText(vm.timeText);
+	if (first || vm.noiseText != old.noiseText)
+		ui->nVal->setText(vm.noiseText);
+	if (first || vm.info1 != old.info1)
+		ui->lblInfo1->setText(vm.info1);
+	if (first || vm.info2 != old.info2)
+		ui->lblInfo2->setText(vm.info2);
+	if (first || vm.title != old.title)
+		ui->stText->setText(vm.title);
+	if (first || vm.sub != old.sub)
+		ui->stSub->setText(vm.sub);
+	if (first || vm.styleType != old.styleType || vm.enabled != old.enabled)
+		updateStyles(vm.styleType, vm.enabled);
+
+	m_rendered = vm;
+	m_hasRendered = true;
+}
 
+void Dashboard::applyEnabled(bool enabled)
+{
 	// 更新开关
 	ui->masterSwitch->blockSignals(true);
 	ui->masterSwitch->setChecked(enabled);
 	ui->masterSwitch->setIcon(QIcon(enabled ? ":/assets/switch_on_1.svg" : ":/assets/switch_off_1.svg"));
 	ui->masterSwitch->blockSignals(false);
 
-	// 1. 更新倒计时数字
 	if (enabled) {
-		ui->tVal->setText(QString("%1s").arg(tNext > 0 ? tNext : 0));
-		ui->nVal->setText(QString("%1s").arg(nNext > 0 ? nNext : 0));
-
-		ui->btnTriggerTime->setIcon(QIcon(drawIcon(Icon_Plane, COL_CYAN, 16)));
-		ui->btnTriggerNoise->setIcon(QIcon(drawIcon(Icon_Plane, COL_AMBER, 16)));
+		ui->btnTriggerTime->setIcon(QIcon(cachedIcon(Icon_Plane, COL_CYAN, 16)));
+		ui->btnTriggerNoise->setIcon(QIcon(cachedIcon(Icon_Plane, COL_AMBER, 16)));
 
 		ui->tVal->setStyleSheet(
 			QString("font-size: 24px; font-weight: bold; font-family: 'Consolas', sans-serif; padding-top: 12px; color: %1; border: none;")
@@ -356,73 +496,21 @@ void Dashboard::onStatusUpdated(const QString &type, const QString &msg, qint64
 			QString("font-size: 24px; font-weight: bold; font-family: 'Consolas', sans-serif; padding-top: 12px; color: %1; border: none;")
 				.arg(COL_AMBER.name()));
 	} else {
-		ui->tVal->setText("--");
-		ui->nVal->setText("--");
-
-		ui->btnTriggerTime->setIcon(QIcon(drawIcon(Icon_Plane, COL_GRAY, 16)));
-		ui->btnTriggerNoise->setIcon(QIcon(drawIcon(Icon_Plane, COL_GRAY, 16)));
+		ui->btnTriggerTime->setIcon(QIcon(cachedIcon(Icon_Plane, COL_GRAY, 16)));
+		ui->btnTriggerNoise->setIcon(QIcon(cachedIcon(Icon_Plane, COL_GRAY, 16)));
 
 		ui->tVal->setStyleSheet(
 			"font-size: 24px; font-weight: bold; font-family: 'Consolas', sans-serif; padding-top: 12px; color: #71717a; border: none;");
 		ui->nVal->setStyleSheet(
 			"font-size: 24px; font-weight: bold; font-family: 'Consolas', sans-serif; padding-top: 12px; color: #71717a; border: none;");
 	}
-
-	QString subLabelStyle =
-		"font-size: 11px; color: #a1a1aa; border: none; qproperty-alignment: AlignBottom | AlignHCenter; margin-bottom: 12px;";
-	ui->lblTitleTime->setStyleSheet(subLabelStyle);
-	ui->lblTitleNoise->setStyleSheet(subLabelStyle);
-
-	// Info样式
-	QString infoStyle = "font-size: 10px; color: #a1a1aa; border: none;";
-	ui->lblInfo1->setText(QString::fromUtf8("插播音色: %1").arg(voiceName));
-	ui->lblInfo1->setStyleSheet(infoStyle);
-
-	ui->lblInfo2->setText(QString::fromUtf8("混淆素材库: %1个文件").arg(noiseCount));
-	ui->lblInfo2->setStyleSheet(infoStyle);
-
-	// 2. 更新状态卡片内容
-	QString displayTitle;
-	QString displaySub;
-	QString queueSuffix = " (0)";
-	if (msg.contains(" (+")) {
-		int idx = msg.lastIndexOf(" (+");
-		if (idx != -1)
-			queueSuffix = msg.mid(idx).trimmed();
-		if (!queueSuffix.startsWith(" "))
-			queueSuffix = " " + queueSuffix;
-	}
-
-	if (!enabled) {
-		displayTitle = QString::fromUtf8("已关闭");
-		displaySub = QString::fromUtf8("智播已停止工作");
-	} else {
-		if (type == "playing_time") {
-			displayTitle = QString::fromUtf8("正在报时");
-			displaySub = QString::fromUtf8("当前播放队列") + queueSuffix;
-		} else if (type == "playing_noise") {
-			displayTitle = QString::fromUtf8("正在播放混淆");
-			displaySub = QString::fromUtf8("当前播放队列") + queueSuffix;
-		} else if (type == "playing_reply") {
-			displayTitle = QString::fromUtf8("正在智能回复");
-			displaySub = QString::fromUtf8("当前播放队列") + queueSuffix;
-		} else {
-			displayTitle = QString::fromUtf8("监控中");
-			displaySub = QString::fromUtf8("正在监控直播间...");
-		}
-	}
-
-	ui->stText->setText(displayTitle);
-	ui->stSub->setText(displaySub);
-
-	updateStyles(enabled ? type : "disabled", enabled);
 }
 
 // 🎯 补回 updateStyles 函数实现 (解决 LNK2001 错误)
 void Dashboard::updateStyles(const QString &type, bool enabled)
 {
 	auto drawStatusIcon = [this](IconType iconType, const QColor &color) -> QPixmap {
-		return drawIcon(iconType, color, 17);
+		return cachedIcon(iconType, color, 17);
 	};
 
 	QString cardStyleBase =
@@ -482,8 +570,6 @@ void Dashboard::updateStyles(const QString &type, bool enabled)
 
 	ui->stText->setStyleSheet(
 		QString("font-size: 18px; font-weight: 900; color: %1; border: none;").arg(titleColor.name()));
-	ui->stSub->setStyleSheet("font-size: 11px; color: #a1a1aa; border: none;");
-
 	ui->iconStatus->setPixmap(drawStatusIcon(iconToDraw, iconColor));
 
 	if (enabled) {
@@ -495,9 +581,28 @@ void Dashboard::updateStyles(const QString &type, bool enabled)
 	}
 }
 
-void Dashboard::onLogMessage(const QString &msg)
+void Dashboard::onLogEvents(const QList<LogEvent> &events)
 {
-	ui->logBox->append(QString("[%1] %2").arg(QDateTime::currentDateTime().toString("HH:mm:ss"), msg));
+	// 事件在这里才格式化成文字，先放进待刷新缓冲，由合并计时器统一追加，突发入队日志只触发一次重排
+	for (const LogEvent &event : events)
+		m_pendingLogs.append(QString("[%1] %2").arg(
+			QDateTime::fromMSecsSinceEpoch(event.time).toString("HH:mm:ss"), EventLog::format(event)));
+	if (m_pendingLogs.size() > kMaxLogLines)
+		m_pendingLogs.erase(m_pendingLogs.begin(), m_pendingLogs.begin() + (m_pendingLogs.size() - kMaxLogLines));
+
+	if (!m_logFlushTimer->isActive())
+		m_logFlushTimer->start();
+}
+
+void Dashboard::flushLogs()
+{
+	if (m_pendingLogs.isEmpty())
+		return;
+
+	// 文档已设置最大块数，超出的旧行由 Qt 自动从头部丢弃
+	ui->logBox->appendPlainText(m_pendingLogs.join('\n'));
+	m_pendingLogs.clear();
+
 	// 强制滚动条到底部
 	QScrollBar *sb = ui->logBox->verticalScrollBar();
 	sb->setValue(sb->maximum());
@@ -4,11 +4,28 @@
 #include <memory>
 #include <QTimer>
 #include <QPixmap>
+#include <QHash>
+#include <QStringList>
+#include "AudioController.h"
+#include "EventLog.h"
 
 namespace Ui {
 class Dashboard;
 }
 
+// 仪表盘视图模型：每次状态推送先算成这份数据，与上次已渲染的比较，只更新变化的控件
+struct DashboardViewModel {
+	bool connected = false;
+	bool enabled = false;
+	QString styleType; // 交给 updateStyles 的状态类型
+	QString timeText;
+	QString noiseText;
+	QString info1;
+	QString info2;
+	QString title;
+	QString sub;
+};
+
 class Dashboard : public QDockWidget {
 	Q_OBJECT
 
@@ -17,10 +34,10 @@ public:
 	virtual ~Dashboard();
 
 private slots:
-	// 🎯 修改：增加 voiceName
-	void onStatusUpdated(const QString &type, const QString &msg, qint64 tNext, qint64 nNext, bool isConnected,
-			     int noiseCount, const QString &voiceName);
-	void onLogMessage(const QString &msg);
+	void onStatusChanged();
+	void refreshStatus();
+	void onLogEvents(const QList<LogEvent> &events);
+	void flushLogs();
 	void showConfigDialog();
 	void updateBreathingEffect();
 
@@ -30,11 +47,31 @@ private:
 	void updateStyles(const QString &type, bool enabled);
 	void updateConnectionState(bool isConnected);
 
+	void render(const DashboardViewModel &vm);
+	void applyEnabled(bool enabled);
+
 	enum IconType { Icon_Settings, Icon_Link, Icon_Plane, Icon_Play, Icon_Stop, Icon_Circle };
-	QPixmap drawIcon(IconType type, const QColor &color, int size);
+	QPixmap drawIcon(IconType type, const QColor &color, int size, qreal dpr);
+	// 着色图标按 (图标, 颜色, 尺寸, DPR) 缓存，状态切换时不再重新栅格化 SVG
+	QPixmap cachedIcon(IconType type, const QColor &color, int size);
+	void warmIconCache();
 
 	QTimer *m_breathTimer;
 	float m_breathStep;
 	float m_currentOpacity;
 	bool m_isConnected;
+
+	// 最近一次收到的控制器快照；倒计时由本地 1 秒计时器按快照里的触发时刻推算
+	std::shared_ptr<const StatusSnapshot> m_status;
+	QTimer *m_countdownTimer;
+
+	DashboardViewModel m_rendered;
+	bool m_hasRendered = false;
+	QHash<quint64, QPixmap> m_iconCache;
+
+	// 日志框只保留最近 kMaxLogLines 行；新日志先进缓冲，每 kLogFlushMs 批量追加一次
+	static constexpr int kMaxLogLines = 500;
+	static constexpr int kLogFlushMs = 100;
+	QStringList m_pendingLogs;
+	QTimer *m_logFlushTimer;
 };
\ No newline at end of file
@@ -0,0 +1,219 @@
+﻿#include "DuckingEngine.h"
+#include "SourceCache.h"
+#include "Metrics.h"
+#include <QHash>
+#include <QPair>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+
+extern "C" {
+#include <obs.h>
+#include <util/platform.h>
+}
+
+// 渐变步进间隔 5ms，足够平滑且开销很小
+static const uint64_t kStepNs = 5000000ULL;
+// dB 曲线的下限，避免 0 音量时出现 -inf
+static const float kFloorDb = -60.0f;
+
+DuckingEngine::DuckingEngine(SourceCache *sources) : m_sources(sources)
+{
+	m_thread = std::thread(&DuckingEngine::run, this);
+}
+
+DuckingEngine::~DuckingEngine()
+{
+	stop();
+}
+
+void DuckingEngine::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_quit)
+			return;
+		m_quit = true;
+	}
+	m_cv.notify_all();
+	if (m_thread.joinable())
+		m_thread.join();
+
+	// 渐变线程已退出，不会再有人改动 m_targets；不做渐变，直接恢复原始音量
+	for (const Target &t : m_targets) {
+		obs_source_t *s = m_sources->acquire(t.name);
+		if (s) {
+			obs_source_set_volume(s, t.original);
+			obs_source_release(s);
+		}
+	}
+	m_targets.clear();
+	m_ducked = false;
+	m_rampActive = false;
+}
+
+void DuckingEngine::setParams(int attackMs, int releaseMs, int curve)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_attackNs = (uint64_t)qMax(0, attackMs) * 1000000ULL;
+	m_releaseNs = (uint64_t)qMax(0, releaseMs) * 1000000ULL;
+	m_curve = (curve >= CurveLinear && curve <= CurveDecibel) ? static_cast<Curve>(curve) : CurveSmooth;
+}
+
+void DuckingEngine::duck(const QStringList &sourceNames, float targetVolume)
+{
+	auto findTarget = [this](const QString &name) {
+		return std::find_if(m_targets.begin(), m_targets.end(),
+				    [&name](const Target &t) { return t.name == name; });
+	};
+
+	// 与 run() 一样，取源和读音量不持锁，避免与 OBS 的锁互相等待：
+	// 先在锁内找出尚未记录的源，锁外读原始音量，再回到锁内登记。
+	// 读的间隙里渐变线程可能刚好恢复完成并清空记录，此时再读一轮 (恢复完成后不会再清空)
+	QHash<QString, float> originals;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		QStringList unread;
+		for (const QString &name : sourceNames) {
+			if (findTarget(name) == m_targets.end() && !originals.contains(name))
+				unread.append(name);
+		}
+		if (unread.isEmpty())
+			break;
+
+		lock.unlock();
+		for (const QString &name : unread) {
+			obs_source_t *s = m_sources->acquire(name);
+			// 取不到的源也记一笔 (负值)，不再重复尝试
+			originals.insert(name, s ? obs_source_get_volume(s) : -1.0f);
+			if (s)
+				obs_source_release(s);
+		}
+		lock.lock();
+	}
+
+	bool changed = !m_ducked;
+	for (const QString &name : sourceNames) {
+		auto it = findTarget(name);
+		if (it == m_targets.end()) {
+			float original = originals.value(name, -1.0f);
+			if (original < 0.0f)
+				continue;
+			Target t;
+			t.name = name;
+			t.original = original;
+			t.current = t.original;
+			m_targets.append(t);
+			it = m_targets.end() - 1;
+			changed = true;
+		}
+		if (it->to != targetVolume)
+			changed = true;
+		it->to = targetVolume;
+	}
+
+	m_ducked = true;
+	if (changed) {
+		for (Target &t : m_targets)
+			t.from = t.current;
+		startRamp(m_attackNs);
+	}
+}
+
+void DuckingEngine::release()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_ducked)
+		return;
+	m_ducked = false;
+	for (Target &t : m_targets) {
+		t.from = t.current;
+		t.to = t.original;
+	}
+	startRamp(m_releaseNs);
+}
+
+bool DuckingEngine::isDucked() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_ducked;
+}
+
+void DuckingEngine::renameSource(const QString &prevName, const QString &newName)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (Target &t : m_targets) {
+		if (t.name == prevName)
+			t.name = newName;
+	}
+}
+
+void DuckingEngine::startRamp(uint64_t durationNs)
+{
+	// 调用方已持锁
+	m_rampStart = os_gettime_ns();
+	m_rampDuration = durationNs;
+	m_rampActive = true;
+	m_cv.notify_all();
+}
+
+float DuckingEngine::shape(float from, float to, float t) const
+{
+	switch (m_curve) {
+	case CurveLinear:
+		return from + (to - from) * t;
+	case CurveDecibel: {
+		// 在 dB 域线性插值，听感上更均匀
+		float fromDb = from > 0.0f ? qMax(kFloorDb, 20.0f * std::log10(from)) : kFloorDb;
+		float toDb = to > 0.0f ? qMax(kFloorDb, 20.0f * std::log10(to)) : kFloorDb;
+		if (t >= 1.0f)
+			return to;
+		return std::pow(10.0f, (fromDb + (toDb - fromDb) * t) / 20.0f);
+	}
+	case CurveSmooth:
+	default:
+		// 余弦 S 曲线，起止处斜率为 0，不会有咔哒感
+		return from + (to - from) * (0.5f - 0.5f * std::cos(t * 3.14159265f));
+	}
+}
+
+void DuckingEngine::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		m_cv.wait(lock, [this]() { return m_quit || m_rampActive; });
+		if (m_quit)
+			return;
+
+		uint64_t now = os_gettime_ns();
+		float t = m_rampDuration > 0 ? (float)qMin<uint64_t>(now - m_rampStart, m_rampDuration) / m_rampDuration
+					     : 1.0f;
+
+		QVector<QPair<QString, float>> updates;
+		updates.reserve(m_targets.size());
+		for (Target &target : m_targets) {
+			target.current = shape(target.from, target.to, t);
+			updates.append(qMakePair(target.name, target.current));
+		}
+
+		if (t >= 1.0f) {
+			m_rampActive = false;
+			Metrics::instance().record(Metrics::DuckRamp, qint64((now - m_rampStart) / 1000));
+			// 恢复完成后忘记原始音量，下次压低重新读取
+			if (!m_ducked)
+				m_targets.clear();
+		}
+
+		// 设置音量时不持锁，避免与 OBS 的锁互相等待
+		lock.unlock();
+		for (const auto &u : updates) {
+			obs_source_t *s = m_sources->acquire(u.first);
+			if (s) {
+				obs_source_set_volume(s, u.second);
+				obs_source_release(s);
+			}
+		}
+		os_sleepto_ns(now + kStepNs);
+		lock.lock();
+	}
+}
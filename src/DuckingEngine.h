@@ -0,0 +1,63 @@
+#pragma once
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+class SourceCache;
+
+// 闪避引擎：按可配置的起止时长和曲线平滑调节背景源音量
+// 由独立线程以高精度定时推进渐变，不依赖 Qt 事件循环的节拍
+class DuckingEngine {
+public:
+	enum Curve { CurveLinear = 0, CurveSmooth = 1, CurveDecibel = 2 };
+
+	explicit DuckingEngine(SourceCache *sources);
+	~DuckingEngine();
+
+	// 停止渐变线程并立即恢复所有源的原始音量；须在 SourceCache 解除挂接前调用，可重复调用
+	void stop();
+
+	void setParams(int attackMs, int releaseMs, int curve);
+
+	// 开始 (或保持) 压低；首次压低的源会记住原始音量
+	void duck(const QStringList &sourceNames, float targetVolume);
+	// 渐变回原始音量，完成后忘记原始音量
+	void release();
+	bool isDucked() const;
+
+	void renameSource(const QString &prevName, const QString &newName);
+
+private:
+	struct Target {
+		QString name;
+		float original = 1.0f;
+		float from = 1.0f;
+		float to = 1.0f;
+		float current = 1.0f;
+	};
+
+	void run();
+	float shape(float from, float to, float t) const;
+	void startRamp(uint64_t durationNs);
+
+	SourceCache *m_sources;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::thread m_thread;
+	bool m_quit = false;
+
+	QList<Target> m_targets;
+	bool m_ducked = false;
+	bool m_rampActive = false;
+	uint64_t m_rampStart = 0;
+	uint64_t m_rampDuration = 0;
+
+	uint64_t m_attackNs = 200000000ULL;
+	uint64_t m_releaseNs = 600000000ULL;
+	Curve m_curve = CurveSmooth;
+};
@@ -0,0 +1,218 @@
+﻿#include "EventLog.h"
+#include <QThread>
+#include <QTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+static const char *const kEventNames[LogEvent::TypeCount] = {
+	"enqueue",       "batch_enqueue",  "preempt",        "drop_expired",     "unsupported_format", "play",
+	"play_seamless", "source_missing", "source_renamed", "playback_timeout", "splice_skipped",     "config_reloaded",
+	"events_dropped",
+};
+
+EventLog &EventLog::instance()
+{
+	static EventLog inst;
+	return inst;
+}
+
+EventLog::EventLog() : m_cells(new Cell[kCapacity])
+{
+	static_assert((kCapacity & (kCapacity - 1)) == 0, "kCapacity must be a power of two");
+	for (int i = 0; i < kCapacity; ++i)
+		m_cells[i].seq.store(quint64(i), std::memory_order_relaxed);
+}
+
+EventLog::~EventLog()
+{
+	stop();
+}
+
+void EventLog::start(const QString &dirPath)
+{
+	if (m_thread)
+		return;
+
+	m_dir = dirPath;
+	QDir().mkpath(m_dir);
+
+	m_thread = new QThread();
+	m_thread->setObjectName("xhs-event-log");
+	m_timer = new QTimer();
+	m_timer->setInterval(kFlushIntervalMs);
+	m_timer->moveToThread(m_thread);
+	// 以计时器为上下文，drain 在写入线程执行
+	connect(m_timer, &QTimer::timeout, m_timer, [this]() { drain(); });
+	connect(m_thread, &QThread::started, m_timer, qOverload<>(&QTimer::start));
+	connect(m_thread, &QThread::finished, m_timer, &QObject::deleteLater);
+	m_thread->start();
+}
+
+void EventLog::stop()
+{
+	if (!m_thread)
+		return;
+
+	m_thread->quit();
+	m_thread->wait();
+	delete m_thread;
+	m_thread = nullptr;
+	m_timer = nullptr;
+
+	// 线程已退出，在这里把剩余事件写完
+	drain();
+	m_file.close();
+}
+
+void EventLog::post(LogEvent::Type type, const QString &subject, const QString &taskType, qint64 value,
+		    const QString &detail)
+{
+	quint64 pos = m_enqueuePos.load(std::memory_order_relaxed);
+	Cell *cell;
+	for (;;) {
+		cell = &m_cells[pos & (kCapacity - 1)];
+		quint64 seq = cell->seq.load(std::memory_order_acquire);
+		qint64 diff = qint64(seq) - qint64(pos);
+		if (diff == 0) {
+			if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			// 写入线程跟不上，丢弃并计数，不阻塞生产者
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		} else {
+			pos = m_enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	LogEvent &event = cell->event;
+	event.time = QDateTime::currentMSecsSinceEpoch();
+	event.type = type;
+	event.taskType = taskType;
+	event.subject = subject;
+	event.detail = detail;
+	event.value = value;
+	cell->seq.store(pos + 1, std::memory_order_release);
+}
+
+void EventLog::drain()
+{
+	QList<LogEvent> events;
+	for (;;) {
+		Cell &cell = m_cells[m_dequeuePos & (kCapacity - 1)];
+		if (cell.seq.load(std::memory_order_acquire) != m_dequeuePos + 1)
+			break;
+		events.append(std::move(cell.event));
+		cell.event = LogEvent();
+		cell.seq.store(m_dequeuePos + kCapacity, std::memory_order_release);
+		++m_dequeuePos;
+	}
+
+	quint64 dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+	if (dropped > 0) {
+		LogEvent event;
+		event.time = QDateTime::currentMSecsSinceEpoch();
+		event.type = LogEvent::EventsDropped;
+		event.value = qint64(dropped);
+		events.append(event);
+	}
+
+	if (events.isEmpty())
+		return;
+
+	write(events);
+	emit eventsReady(events);
+}
+
+void EventLog::write(const QList<LogEvent> &events)
+{
+	if (m_dir.isEmpty())
+		return;
+
+	if (!m_file.isOpen()) {
+		m_file.setFileName(filePath(0));
+		if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append))
+			return;
+	}
+
+	QByteArray data;
+	for (const LogEvent &event : events)
+		data += toJsonLine(event);
+	m_file.write(data);
+	m_file.flush();
+
+	if (m_file.size() >= kMaxFileBytes)
+		rotate();
+}
+
+void EventLog::rotate()
+{
+	// events.jsonl -> events.1.jsonl -> ... 最旧的一份删除
+	m_file.close();
+	QFile::remove(filePath(kMaxFiles - 1));
+	for (int i = kMaxFiles - 2; i >= 0; --i)
+		QFile::rename(filePath(i), filePath(i + 1));
+}
+
+QString EventLog::filePath(int index) const
+{
+	if (index == 0)
+		return m_dir + "/events.jsonl";
+	return m_dir + QString("/events.%1.jsonl").arg(index);
+}
+
+QByteArray EventLog::toJsonLine(const LogEvent &event)
+{
+	QJsonObject obj;
+	obj["ts"] = event.time;
+	obj["event"] = kEventNames[event.type];
+	if (!event.taskType.isEmpty())
+		obj["task"] = event.taskType;
+	if (!event.subject.isEmpty())
+		obj["subject"] = event.subject;
+	if (!event.detail.isEmpty())
+		obj["detail"] = event.detail;
+	if (event.value != 0)
+		obj["value"] = event.value;
+	return QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+}
+
+QString EventLog::format(const LogEvent &event)
+{
+	QString fileName = QFileInfo(event.subject).fileName();
+	switch (event.type) {
+	case LogEvent::Enqueue:
+		return QString::fromUtf8(">>> [入队] ") + fileName;
+	case LogEvent::BatchEnqueue:
+		return QString::fromUtf8(">>> [批量入队] %1 条").arg(event.value);
+	case LogEvent::Preempt:
+		return QString::fromUtf8("⏭️ 回复插播，打断暖场: ") + fileName;
+	case LogEvent::DropExpired:
+		return QString::fromUtf8("⚠️ [%1] 任务过期(%2s)，已丢弃: ").arg(event.taskType).arg(event.value / 1000) +
+		       fileName;
+	case LogEvent::UnsupportedFormat:
+		return QString::fromUtf8(">>> [错误] 内置音频源仅支持 WAV，跳过: ") + fileName;
+	case LogEvent::Play:
+		return "[" + event.taskType + "] " + QString::fromUtf8("播放: ") + fileName;
+	case LogEvent::PlaySeamless:
+		return "[" + event.taskType + "] " + QString::fromUtf8("无缝播放: ") + fileName;
+	case LogEvent::SourceMissing:
+		return QString::fromUtf8(">>> [错误] 找不到媒体源，跳过");
+	case LogEvent::SourceRenamed:
+		return QString::fromUtf8("OBS 源已改名，配置同步更新: ") + event.subject + " -> " + event.detail;
+	case LogEvent::PlaybackTimeout:
+		return QString::fromUtf8(">>> [异常] 播放超时，强制跳过");
+	case LogEvent::SpliceSkipped:
+		return QString::fromUtf8("⚠️ 音频格式不一致或已损坏，拼接时跳过: ") + fileName;
+	case LogEvent::ConfigReloaded:
+		return QString::fromUtf8("配置文件已修改，重新加载");
+	case LogEvent::EventsDropped:
+		return QString::fromUtf8("⚠️ 日志过多，已丢弃 %1 条").arg(event.value);
+	case LogEvent::TypeCount:
+		break;
+	}
+	return QString();
+}
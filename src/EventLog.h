@@ -0,0 +1,91 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QFile>
+#include <QMetaType>
+#include <atomic>
+#include <memory>
+
+class QThread;
+class QTimer;
+
+// 一条结构化日志事件：只保存原始字段，文字在消费端 (停靠栏、导出文件) 需要时才格式化
+struct LogEvent {
+	enum Type {
+		Enqueue = 0,       // subject: 文件路径
+		BatchEnqueue,      // value: 条数
+		Preempt,           // subject: 被打断的文件
+		DropExpired,       // taskType, subject, value: 已排队毫秒数
+		UnsupportedFormat, // subject
+		Play,              // taskType, subject
+		PlaySeamless,      // taskType, subject
+		SourceMissing,
+		SourceRenamed,     // subject: 旧名, detail: 新名
+		PlaybackTimeout,
+		SpliceSkipped,     // subject
+		ConfigReloaded,    // subject: 配置文件路径
+		EventsDropped,     // value: 环形缓冲满时丢弃的条数
+		TypeCount
+	};
+
+	qint64 time = 0; // ms
+	Type type = Enqueue;
+	QString taskType;
+	QString subject;
+	QString detail;
+	qint64 value = 0;
+};
+Q_DECLARE_METATYPE(LogEvent)
+
+// 异步事件日志：任意线程无锁写入有界环形缓冲，后台线程定时取出，
+// 追加到模块配置目录下按大小轮转的 JSON Lines 文件，并整批转发给界面
+class EventLog : public QObject {
+	Q_OBJECT
+public:
+	static EventLog &instance();
+
+	// dirPath 为日志目录；未启动时事件只在缓冲中累积，满了即丢弃
+	void start(const QString &dirPath);
+	void stop();
+
+	void post(LogEvent::Type type, const QString &subject = QString(), const QString &taskType = QString(),
+		  qint64 value = 0, const QString &detail = QString());
+
+	static QString format(const LogEvent &event);
+	static QByteArray toJsonLine(const LogEvent &event);
+
+signals:
+	// 在写入线程发出
+	void eventsReady(const QList<LogEvent> &events);
+
+private:
+	EventLog();
+	~EventLog();
+
+	static constexpr int kCapacity = 4096; // 必须是 2 的幂
+	static constexpr int kFlushIntervalMs = 200;
+	static constexpr qint64 kMaxFileBytes = 2 * 1024 * 1024;
+	static constexpr int kMaxFiles = 5; // events.jsonl + events.1 ~ events.4
+
+	// 只在消费者 (写入线程，或线程停止后的调用方) 上执行
+	void drain();
+	void write(const QList<LogEvent> &events);
+	void rotate();
+	QString filePath(int index) const;
+
+	// Vyukov 有界 MPMC 环形缓冲，这里只有一个消费者
+	struct Cell {
+		std::atomic<quint64> seq{0};
+		LogEvent event;
+	};
+	std::unique_ptr<Cell[]> m_cells;
+	std::atomic<quint64> m_enqueuePos{0};
+	quint64 m_dequeuePos = 0;
+	std::atomic<quint64> m_dropped{0};
+
+	QString m_dir;
+	QFile m_file;
+	QThread *m_thread = nullptr;
+	QTimer *m_timer = nullptr;
+};
@@ -0,0 +1,124 @@
+﻿#include "HttpParser.h"
+
+QByteArray HttpRequest::header(const QByteArray &name) const
+{
+	for (const auto &h : headers) {
+		if (h.first == name)
+			return h.second;
+	}
+	return QByteArray();
+}
+
+void HttpParser::setLimits(int maxHeaderBytes, int maxBodyBytes)
+{
+	m_maxHeaderBytes = qMax(1024, maxHeaderBytes);
+	m_maxBodyBytes = qMax(0, maxBodyBytes);
+}
+
+HttpParser::Result HttpParser::fail(int status)
+{
+	m_errorStatus = status;
+	m_buffer.clear();
+	m_pos = 0;
+	return Error;
+}
+
+bool HttpParser::parseHead(const QByteArray &head)
+{
+	QList<QByteArray> lines = head.split('\n');
+	for (QByteArray &line : lines) {
+		if (line.endsWith('\r'))
+			line.chop(1);
+	}
+
+	QList<QByteArray> parts = lines[0].split(' ');
+	if (parts.size() != 3 || parts[0].isEmpty() || parts[1].isEmpty() || !parts[2].startsWith("HTTP/1."))
+		return false;
+
+	m_pending = HttpRequest();
+	m_pending.method = parts[0];
+	m_pending.target = parts[1];
+	m_pending.version = parts[2];
+
+	for (int i = 1; i < lines.size(); ++i) {
+		const QByteArray &line = lines[i];
+		if (line.isEmpty())
+			continue;
+		int colon = line.indexOf(':');
+		if (colon <= 0)
+			return false;
+		m_pending.headers.append(qMakePair(line.left(colon).trimmed().toLower(), line.mid(colon + 1).trimmed()));
+	}
+
+	// HTTP/1.1 默认长连接，1.0 需显式声明
+	QByteArray connection = m_pending.header("connection").toLower();
+	if (m_pending.version == "HTTP/1.0")
+		m_pending.keepAlive = connection.contains("keep-alive");
+	else
+		m_pending.keepAlive = !connection.contains("close");
+	return true;
+}
+
+HttpParser::Result HttpParser::next(HttpRequest &request)
+{
+	if (!m_haveHead) {
+		// 流水线请求之间允许出现多余的空行
+		while (m_pos < m_buffer.size() && (m_buffer[m_pos] == '\r' || m_buffer[m_pos] == '\n'))
+			++m_pos;
+
+		int end = m_buffer.indexOf("\r\n\r\n", m_pos);
+		int sepLen = 4;
+		if (end < 0) {
+			end = m_buffer.indexOf("\n\n", m_pos);
+			sepLen = 2;
+		}
+		if (end < 0) {
+			if (m_buffer.size() - m_pos > m_maxHeaderBytes)
+				return fail(431);
+			// 已消费的前缀及时丢掉，避免长连接上缓冲区无限增长
+			if (m_pos > 0) {
+				m_buffer.remove(0, m_pos);
+				m_pos = 0;
+			}
+			return NeedMore;
+		}
+		if (end - m_pos > m_maxHeaderBytes)
+			return fail(431);
+
+		if (!parseHead(m_buffer.mid(m_pos, end - m_pos)))
+			return fail(400);
+		m_pos = end + sepLen;
+
+		// 不支持分块传输，客户端应带 Content-Length
+		if (!m_pending.header("transfer-encoding").isEmpty())
+			return fail(501);
+
+		m_bodyLength = 0;
+		QByteArray lengthHeader = m_pending.header("content-length");
+		if (!lengthHeader.isEmpty()) {
+			bool ok = false;
+			m_bodyLength = lengthHeader.toLongLong(&ok);
+			if (!ok || m_bodyLength < 0)
+				return fail(400);
+			if (m_bodyLength > m_maxBodyBytes)
+				return fail(413);
+		}
+		m_haveHead = true;
+	}
+
+	if (m_buffer.size() - m_pos < m_bodyLength)
+		return NeedMore;
+
+	m_pending.body = m_buffer.mid(m_pos, int(m_bodyLength));
+	m_pos += int(m_bodyLength);
+	m_haveHead = false;
+
+	if (m_pos >= m_buffer.size()) {
+		m_buffer.clear();
+		m_pos = 0;
+	}
+
+	request = std::move(m_pending);
+	m_pending = HttpRequest();
+	return Complete;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+
+// 一个完整解析出的 HTTP 请求
+struct HttpRequest {
+	QByteArray method;
+	QByteArray target;  // 原始请求目标，如 "/play?path=xxx"
+	QByteArray version; // "HTTP/1.1"
+	QList<QPair<QByteArray, QByteArray>> headers; // 头名已转小写
+	QByteArray body;
+	bool keepAlive = true;
+
+	QByteArray header(const QByteArray &name) const;
+};
+
+// 按连接维护的增量 HTTP/1.1 解析器
+// 数据可以分多次到达，也可以一次带来多个流水线请求；每次 next() 取出一个完整请求
+class HttpParser {
+public:
+	enum Result { NeedMore, Complete, Error };
+
+	void setLimits(int maxHeaderBytes, int maxBodyBytes);
+	void feed(const QByteArray &data) { m_buffer.append(data); }
+	Result next(HttpRequest &request);
+
+	// Error 时对应的 HTTP 状态码 (400/413/431/501)
+	int errorStatus() const { return m_errorStatus; }
+	bool hasBufferedData() const { return m_pos < m_buffer.size(); }
+	// 已收到一个请求的部分内容 (头部未完或正文未齐)
+	bool inRequest() const { return m_haveHead || hasBufferedData(); }
+
+private:
+	Result fail(int status);
+	bool parseHead(const QByteArray &head);
+
+	QByteArray m_buffer;
+	int m_pos = 0;
+
+	// 头部已解析、正在等待正文
+	bool m_haveHead = false;
+	qint64 m_bodyLength = 0;
+	HttpRequest m_pending;
+
+	int m_errorStatus = 0;
+	int m_maxHeaderBytes = 16 * 1024;
+	int m_maxBodyBytes = 1024 * 1024;
+};
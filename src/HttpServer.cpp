@@ -1,105 +1,637 @@
 ﻿#include "HttpServer.h"
 #include "AudioController.h"
+#include "Metrics.h"
 #include <QUrl>
 #include <QUrlQuery>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonArray>
+#include <QDateTime>
 #include <QDebug>
 
-HttpServer::HttpServer(QObject *parent) : QTcpServer(parent) {}
+namespace {
+struct StaticResponseInfo {
+	int statusCode;
+	const char *body;
+	const char *extraHeaders;
+};
 
-bool HttpServer::start(quint16 port)
+// 顺序与 HttpServer::StaticResponse 一致
+const StaticResponseInfo kStaticResponses[] = {
+	{200, "{\"status\":\"ok\"}", nullptr},
+	{200, "{\"status\":\"online\"}", nullptr},
+	{400, "{\"status\":\"error\",\"message\":\"missing_path_parameter\"}", nullptr},
+	{400, "{\"status\":\"error\",\"message\":\"bad_request\"}", nullptr},
+	{404, "{\"status\":\"error\",\"message\":\"route_not_found\"}", nullptr},
+	{405, "{\"status\":\"error\",\"message\":\"method_not_allowed\"}", nullptr},
+	{408, "{\"status\":\"error\",\"message\":\"request_timeout\"}", nullptr},
+	{413, "{\"status\":\"error\",\"message\":\"request_too_large\"}", nullptr},
+	{429, "{\"status\":\"error\",\"message\":\"rate_limited\"}", "Retry-After: 1\r\n"},
+	{431, "{\"status\":\"error\",\"message\":\"request_too_large\"}", nullptr},
+	{501, "{\"status\":\"error\",\"message\":\"unsupported_transfer_encoding\"}", nullptr},
+	{503, "{\"status\":\"error\",\"message\":\"too_many_connections\"}", "Retry-After: 1\r\n"},
+};
+
+const QByteArray kJsonContentType("application/json; charset=utf-8");
+
+#ifdef XHS_HTTP_BASELINE_RESPONSES
+// 仅供压测工具的对照构建 (xhs-loadtest-baseline)：还原合并缓冲之前的发送方式，
+// 每个头各写一次、应答后立即 flush，固定应答每次重新序列化 JSON；插件本身从不定义这个宏
+void writeBaselineResponse(QTcpSocket *socket, int statusCode, const char *reason, const QByteArray &body,
+			   bool keepAlive, const QByteArray &contentType, const char *extraHeaders,
+			   const PluginConfig &config)
+{
+	socket->write("HTTP/1.1 " + QByteArray::number(statusCode) + " " + reason + "\r\n");
+	socket->write("Content-Type: " + contentType + "\r\n");
+	socket->write("Content-Length: " + QByteArray::number(body.size()) + "\r\n");
+	socket->write("Access-Control-Allow-Origin: " + config.httpCorsOrigin.toUtf8() + "\r\n");
+	socket->write("Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n");
+	socket->write("Access-Control-Allow-Headers: Content-Type\r\n");
+	if (extraHeaders)
+		socket->write(extraHeaders);
+	if (keepAlive) {
+		socket->write("Connection: keep-alive\r\n");
+		if (config.httpIdleTimeoutMs > 0)
+			socket->write("Keep-Alive: timeout=" + QByteArray::number(config.httpIdleTimeoutMs / 1000) +
+				      "\r\n");
+	} else {
+		socket->write("Connection: close\r\n");
+	}
+	socket->write("\r\n");
+	socket->write(body);
+	socket->flush();
+}
+#endif
+}
+
+HttpServer::HttpServer(QObject *parent) : QTcpServer(parent)
+{
+	m_eventKeepAliveTimer = new QTimer(this);
+	connect(m_eventKeepAliveTimer, &QTimer::timeout, this, &HttpServer::sendEventKeepAlive);
+
+	// 控制器在自己的线程发出状态，这里排队到服务线程再写给订阅者
+	connect(&AudioController::instance(), &AudioController::statusChanged, this, &HttpServer::onStatusChanged,
+		Qt::QueuedConnection);
+	connect(&AudioController::instance(), &AudioController::configChanged, this, &HttpServer::applyConfig,
+		Qt::QueuedConnection);
+}
+
+HttpServer::~HttpServer()
+{
+	qDeleteAll(m_connections);
+}
+
+bool HttpServer::start(const PluginConfig &config, quint16 port)
+{
+	applyConfig(config);
+
+	QHostAddress address(config.httpBindAddress);
+	if (address.isNull())
+		address = QHostAddress::Any;
+	if (!this->listen(address, port))
+		return false;
+	m_eventKeepAliveTimer->start(kEventKeepAliveMs);
+	onStatusChanged();
+	return true;
+}
+
+void HttpServer::applyConfig(const PluginConfig &config)
 {
-	return this->listen(QHostAddress::Any, port);
+	m_config = config;
+	rebuildStaticResponses();
+	for (Connection *conn : m_connections)
+		conn->parser.setLimits(config.httpMaxHeaderBytes, config.httpMaxBodyBytes);
+	m_rateBuckets.clear();
 }
 
 void HttpServer::incomingConnection(qintptr socketDescriptor)
 {
 	QTcpSocket *socket = new QTcpSocket(this);
 	socket->setSocketDescriptor(socketDescriptor);
+	connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+
+	// 连接数已满：直接回 503 并关闭，不分配解析状态，也不碰控制器
+	if (m_config.httpMaxConnections > 0 && m_connections.size() >= m_config.httpMaxConnections) {
+		sendStatic(socket, StaticTooManyConnections, false);
+		return;
+	}
+
+	Connection *conn = new Connection;
+	conn->parser.setLimits(m_config.httpMaxHeaderBytes, m_config.httpMaxBodyBytes);
+	conn->idleTimer = new QTimer(socket);
+	conn->idleTimer->setSingleShot(true);
+	connect(conn->idleTimer, &QTimer::timeout, this, [this, socket]() { handleTimeout(socket); });
+	armTimer(conn, m_config.httpIdleTimeoutMs);
+	m_connections.insert(socket, conn);
+
 	connect(socket, &QTcpSocket::readyRead, this, &HttpServer::handleReadyRead);
 	connect(socket, &QTcpSocket::disconnected, this, &HttpServer::handleDisconnected);
 }
 
+void HttpServer::handleTimeout(QTcpSocket *socket)
+{
+	Connection *conn = m_connections.value(socket);
+	if (!conn)
+		return;
+	// 请求只收到一半就停住 (慢速攻击或客户端异常) 回 408；单纯空闲则静默关闭
+	if (conn->readingRequest)
+		sendStatic(socket, StaticRequestTimeout, false);
+	else
+		socket->disconnectFromHost();
+}
+
+bool HttpServer::allowRequest(const QHostAddress &peer)
+{
+	if (m_config.httpRatePerSecond <= 0.0)
+		return true;
+
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	double burst = qMax(1, m_config.httpRateBurst);
+
+	// 客户端很多时顺手清掉已经回满的桶，防止表无限增长
+	if (m_rateBuckets.size() > 1024) {
+		for (auto it = m_rateBuckets.begin(); it != m_rateBuckets.end();) {
+			double refilled = it->tokens + (now - it->lastMs) * m_config.httpRatePerSecond / 1000.0;
+			it = refilled >= burst ? m_rateBuckets.erase(it) : it + 1;
+		}
+	}
+
+	QString key = peer.toString();
+	auto it = m_rateBuckets.find(key);
+	if (it == m_rateBuckets.end()) {
+		RateBucket bucket;
+		bucket.tokens = burst;
+		bucket.lastMs = now;
+		it = m_rateBuckets.insert(key, bucket);
+	}
+
+	it->tokens = qMin(burst, it->tokens + (now - it->lastMs) * m_config.httpRatePerSecond / 1000.0);
+	it->lastMs = now;
+	if (it->tokens < 1.0)
+		return false;
+	it->tokens -= 1.0;
+	return true;
+}
+
 void HttpServer::handleReadyRead()
 {
 	QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
-	if (!socket)
+	Connection *conn = m_connections.value(socket);
+	if (!conn)
 		return;
 
-	QByteArray data = socket->readAll();
-	QString request = QString::fromUtf8(data);
-	QStringList lines = request.split("\r\n");
-	if (lines.isEmpty())
+	// 推送流上客户端不再发送请求，多余数据直接丢弃
+	if (conn->streaming) {
+		socket->readAll();
 		return;
+	}
 
-	QString firstLine = lines[0];
-	QStringList parts = firstLine.split(" ");
-	if (parts.size() < 2)
-		return;
+	conn->parser.feed(socket->readAll());
+
+	// 一次读取可能包含半个请求，也可能包含多个流水线请求，按顺序逐个应答
+	HttpRequest request;
+	for (;;) {
+		HttpParser::Result result = conn->parser.next(request);
+		if (result == HttpParser::NeedMore)
+			break;
+		if (result == HttpParser::Error) {
+			int status = conn->parser.errorStatus();
+			StaticResponse kind = status == 413   ? StaticPayloadTooLarge
+					      : status == 431 ? StaticHeadersTooLarge
+					      : status == 501 ? StaticNotImplemented
+							      : StaticBadRequest;
+			sendStatic(socket, kind, false);
+			return;
+		}
+
+		// 限流在路由之前完成，超额请求不会进入控制器
+		if (!allowRequest(socket->peerAddress())) {
+			sendStatic(socket, StaticRateLimited, request.keepAlive);
+			if (!request.keepAlive)
+				return;
+			continue;
+		}
+
+		if (request.method == "GET" && QUrl(QString::fromUtf8(request.target)).path() == "/events") {
+			startEventStream(socket, conn);
+			return;
+		}
+
+		qint64 startMicros = Metrics::nowMicros();
+		handleRequest(socket, request);
+		Metrics::instance().inc(Metrics::HttpRequests);
+		Metrics::instance().record(Metrics::HttpHandle, Metrics::nowMicros() - startMicros);
+		if (!request.keepAlive || socket->state() != QAbstractSocket::ConnectedState)
+			return;
+	}
+
+	// 缓冲里还有半个请求时按读超时计 (从请求开始算，不随每个分片重置)；否则回到空闲超时
+	if (conn->parser.inRequest()) {
+		if (!conn->readingRequest) {
+			conn->readingRequest = true;
+			armTimer(conn, m_config.httpReadTimeoutMs);
+		}
+	} else {
+		conn->readingRequest = false;
+		armTimer(conn, m_config.httpIdleTimeoutMs);
+	}
+}
 
-	QString method = parts[0];
-	QUrl url(parts[1]);
+void HttpServer::armTimer(Connection *conn, int timeoutMs)
+{
+	// 超时为 0 表示不限，不能 start(0)，否则连接会被立刻关闭
+	if (timeoutMs > 0)
+		conn->idleTimer->start(timeoutMs);
+	else
+		conn->idleTimer->stop();
+}
+
+void HttpServer::handleRequest(QTcpSocket *socket, const HttpRequest &request)
+{
+	QString method = QString::fromLatin1(request.method);
+	QUrl url(QString::fromUtf8(request.target));
 	QString path = url.path();
+	bool keepAlive = request.keepAlive;
 
 	if (method == "OPTIONS") {
-		sendResponse(socket, 200, "{\"status\":\"ok\"}");
+		sendStatic(socket, StaticOptions, keepAlive);
 		return;
 	}
 
 	QJsonObject responseJson;
 
-	if (path == "/play") {
-		QUrlQuery query(url.query());
-		QString audioPath = QUrl::fromPercentEncoding(query.queryItemValue("path").toUtf8());
-		if (!audioPath.isEmpty()) {
-			QString pickedFile = AudioController::instance().enqueueTaskAndReturn(audioPath, "reply");
-			if (!pickedFile.isEmpty()) {
-				responseJson["status"] = "success";
-				responseJson["file"] = pickedFile;
-				sendResponse(socket, 200, QJsonDocument(responseJson).toJson());
-			} else {
-				responseJson["status"] = "error";
-				responseJson["message"] = "no_valid_audio_file_found";
-				sendResponse(socket, 404, QJsonDocument(responseJson).toJson());
+	if (path == "/play/batch") {
+		if (method != "POST") {
+			sendStatic(socket, StaticMethodNotAllowed, keepAlive);
+			return;
+		}
+		handleBatchPlay(socket, request.body, keepAlive);
+	} else if (path == "/play") {
+		handlePlay(socket, QUrlQuery(url.query()), keepAlive);
+	} else if (path == "/scheduler") {
+		// 最近的调度决策及回复延迟统计，用于衡量端到端回复延迟
+		const PluginConfig &cfg = m_config;
+		QJsonObject policy;
+		policy["replyFirst"] = cfg.replyFirst;
+		policy["replyPreempt"] = cfg.replyPreempt;
+		policy["replyDeadlineMs"] = cfg.replyDeadlineMs;
+		policy["timeDeadlineMs"] = cfg.timeDeadlineMs;
+		policy["noiseDeadlineMs"] = cfg.noiseDeadlineMs;
+
+		QJsonArray decisions;
+		int replyCount = 0;
+		qint64 replyTotalMs = 0;
+		qint64 replyMaxMs = 0;
+		for (const SchedulerDecision &d : AudioController::instance().recentDecisions()) {
+			QJsonObject item;
+			item["time"] = d.time;
+			item["action"] = d.action;
+			item["type"] = d.type;
+			item["file"] = d.file;
+			item["waitMs"] = d.waitMs;
+			decisions.append(item);
+
+			if (d.action == "play" && d.type == "reply") {
+				++replyCount;
+				replyTotalMs += d.waitMs;
+				replyMaxMs = qMax(replyMaxMs, d.waitMs);
 			}
-		} else {
-			responseJson["status"] = "error";
-			responseJson["message"] = "missing_path_parameter";
-			sendResponse(socket, 400, QJsonDocument(responseJson).toJson());
 		}
+
+		QJsonObject replyLatency;
+		replyLatency["count"] = replyCount;
+		replyLatency["avgMs"] = replyCount > 0 ? replyTotalMs / replyCount : 0;
+		replyLatency["maxMs"] = replyMaxMs;
+
+		responseJson["status"] = "success";
+		responseJson["policy"] = policy;
+		responseJson["replyLatency"] = replyLatency;
+		responseJson["decisions"] = decisions;
+		sendResponse(socket, 200, QJsonDocument(responseJson).toJson(), keepAlive);
+	} else if (path == "/metrics") {
+		QByteArray text = Metrics::instance().exportPrometheus(AudioController::instance().queueDepth());
+		sendResponse(socket, 200, text, keepAlive, "text/plain; version=0.0.4; charset=utf-8");
 	} else if (path == "/status") {
 		// 🎯 核心修改：收到 Chrome 请求，记录心跳
 		AudioController::instance().recordHeartbeat();
-		responseJson["status"] = "online";
-		sendResponse(socket, 200, QJsonDocument(responseJson).toJson());
+		sendStatic(socket, StaticOnline, keepAlive);
+	} else {
+		sendStatic(socket, StaticNotFound, keepAlive);
+	}
+}
+
+void HttpServer::handlePlay(QTcpSocket *socket, const QUrlQuery &query, bool keepAlive)
+{
+	QJsonObject responseJson;
+	QString audioPath = QUrl::fromPercentEncoding(query.queryItemValue("path").toUtf8());
+	if (audioPath.isEmpty()) {
+		sendStatic(socket, StaticMissingPath, keepAlive);
+		return;
+	}
+
+	// 浏览器端超时重试会带着同一个 request_id 再来一次，带 id 时只按 id 去重；
+	// 不带 id 的旧客户端才按路径在短窗口内合并，避免两条不同的回复被误判为重复
+	QString requestId = query.queryItemValue("request_id");
+	QString dedupKey;
+	int dedupTtlMs;
+	if (!requestId.isEmpty()) {
+		dedupKey = "id:" + requestId;
+		dedupTtlMs = m_config.requestIdTtlMs;
 	} else {
+		dedupKey = "path:" + audioPath;
+		dedupTtlMs = m_config.dedupWindowMs;
+	}
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	RequestDedupCache::Entry hit;
+	if (m_dedup.lookup(dedupKey, now, hit)) {
+		hit.response["duplicate"] = true;
+		sendResponse(socket, hit.statusCode, QJsonDocument(hit.response).toJson(), keepAlive);
+		return;
+	}
+
+	int statusCode = 200;
+	QString pickedFile = AudioController::instance().enqueueTaskAndReturn(audioPath, "reply");
+	if (!pickedFile.isEmpty()) {
+		responseJson["status"] = "success";
+		responseJson["file"] = pickedFile;
+	} else {
+		statusCode = 404;
+		responseJson["status"] = "error";
+		responseJson["message"] = "no_valid_audio_file_found";
+	}
+	if (!requestId.isEmpty()) {
+		responseJson["request_id"] = requestId;
+		m_dedup.insert(dedupKey, statusCode, responseJson, now, dedupTtlMs);
+	} else if (statusCode == 200) {
+		// 失败的请求不占用路径窗口，客户端修正后可立即重试
+		m_dedup.insert(dedupKey, statusCode, responseJson, now, dedupTtlMs);
+	}
+	sendResponse(socket, statusCode, QJsonDocument(responseJson).toJson(), keepAlive);
+}
+
+// 请求体：[{"path": "...", "type": "reply"}, "D:/voice/xxx", ...]，纯字符串视为 reply
+void HttpServer::handleBatchPlay(QTcpSocket *socket, const QByteArray &body, bool keepAlive)
+{
+	QJsonObject responseJson;
+	QJsonParseError parseError;
+	QJsonDocument doc = QJsonDocument::fromJson(body, &parseError);
+	if (parseError.error != QJsonParseError::NoError || !doc.isArray()) {
 		responseJson["status"] = "error";
-		responseJson["message"] = "route_not_found";
-		sendResponse(socket, 404, QJsonDocument(responseJson).toJson());
+		responseJson["message"] = "invalid_json_array";
+		sendResponse(socket, 400, QJsonDocument(responseJson).toJson(), keepAlive);
+		return;
+	}
+
+	const QJsonArray items = doc.array();
+	QList<EnqueueRequest> requests;
+	QList<int> requestIndex; // 有效条目在原数组中的下标
+	QJsonArray results;
+	for (int i = 0; i < items.size(); ++i) {
+		EnqueueRequest req;
+		if (items[i].isString()) {
+			req.path = items[i].toString();
+			req.type = "reply";
+		} else {
+			QJsonObject item = items[i].toObject();
+			req.path = item["path"].toString();
+			req.type = item["type"].toString("reply");
+		}
+
+		QJsonObject result;
+		result["index"] = i;
+		if (req.path.isEmpty()) {
+			result["status"] = "error";
+			result["message"] = "missing_path_parameter";
+		} else if (req.type != "reply" && req.type != "noise" && req.type != "time") {
+			result["status"] = "error";
+			result["message"] = "invalid_type";
+		} else {
+			requests.append(req);
+			requestIndex.append(i);
+		}
+		results.append(result);
 	}
+
+	// 整批一次交给控制器，保证这批任务在队列中连续
+	QList<EnqueueResult> enqueued = AudioController::instance().enqueueBatch(requests);
+	int accepted = 0;
+	for (int k = 0; k < enqueued.size(); ++k) {
+		QJsonObject result = results[requestIndex[k]].toObject();
+		if (enqueued[k].file.isEmpty()) {
+			result["status"] = "error";
+			result["message"] = "no_valid_audio_file_found";
+		} else {
+			result["status"] = "queued";
+			result["file"] = enqueued[k].file;
+			result["position"] = enqueued[k].position;
+			++accepted;
+		}
+		results[requestIndex[k]] = result;
+	}
+
+	responseJson["status"] = accepted > 0 ? "success" : "error";
+	responseJson["accepted"] = accepted;
+	responseJson["results"] = results;
+	// 与 /play 一致：一条都没入队时返回 404，全部或部分成功返回 200
+	sendResponse(socket, accepted > 0 ? 200 : 404, QJsonDocument(responseJson).toJson(), keepAlive);
+}
+
+const char *HttpServer::reasonPhrase(int statusCode)
+{
+	switch (statusCode) {
+	case 200:
+		return "OK";
+	case 400:
+		return "Bad Request";
+	case 404:
+		return "Not Found";
+	case 405:
+		return "Method Not Allowed";
+	case 408:
+		return "Request Timeout";
+	case 413:
+		return "Payload Too Large";
+	case 429:
+		return "Too Many Requests";
+	case 431:
+		return "Request Header Fields Too Large";
+	case 501:
+		return "Not Implemented";
+	case 503:
+		return "Service Unavailable";
+	default:
+		return "Error";
+	}
+}
+
+void HttpServer::rebuildStaticResponses()
+{
+	static_assert(sizeof(kStaticResponses) / sizeof(kStaticResponses[0]) == StaticResponseCount,
+		      "static response table out of sync");
+
+	// 公共头尾部每种连接方式只拼一次，动态应答也直接复用
+	QByteArray cors = "Access-Control-Allow-Origin: " + m_config.httpCorsOrigin.toUtf8() +
+			  "\r\n"
+			  "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
+			  "Access-Control-Allow-Headers: Content-Type\r\n";
+	m_headerTail[0] = cors + "Connection: close\r\n\r\n";
+	m_headerTail[1] = cors + "Connection: keep-alive\r\n";
+	if (m_config.httpIdleTimeoutMs > 0)
+		m_headerTail[1] += "Keep-Alive: timeout=" + QByteArray::number(m_config.httpIdleTimeoutMs / 1000) + "\r\n";
+	m_headerTail[1] += "\r\n";
+
+	for (int kind = 0; kind < StaticResponseCount; ++kind) {
+		const StaticResponseInfo &info = kStaticResponses[kind];
+		for (int keepAlive = 0; keepAlive < 2; ++keepAlive) {
+			m_staticResponses[kind][keepAlive] = buildResponse(info.statusCode, QByteArray(info.body),
+									   keepAlive != 0, kJsonContentType,
+									   info.extraHeaders);
+		}
+	}
+}
+
+QByteArray HttpServer::buildResponse(int statusCode, const QByteArray &body, bool keepAlive,
+				     const QByteArray &contentType, const char *extraHeaders) const
+{
+	const QByteArray &tail = m_headerTail[keepAlive ? 1 : 0];
+
+	// 状态行、头和正文一次拼进同一块缓冲，整个应答只发一次写
+	QByteArray out;
+	out.reserve(64 + contentType.size() + tail.size() + body.size() + (extraHeaders ? 32 : 0));
+	out.append("HTTP/1.1 ").append(QByteArray::number(statusCode)).append(' ').append(reasonPhrase(statusCode));
+	out.append("\r\nContent-Type: ").append(contentType);
+	out.append("\r\nContent-Length: ").append(QByteArray::number(body.size())).append("\r\n");
+	if (extraHeaders)
+		out.append(extraHeaders);
+	out.append(tail);
+	out.append(body);
+	return out;
 }
 
-void HttpServer::sendResponse(QTcpSocket *socket, int statusCode, const QByteArray &body)
+void HttpServer::writeResponse(QTcpSocket *socket, int statusCode, const QByteArray &data, bool keepAlive)
 {
+	if (statusCode >= 400)
+		Metrics::instance().inc(Metrics::HttpErrors);
 	if (socket->state() != QAbstractSocket::ConnectedState)
 		return;
-	socket->write("HTTP/1.1 " + QByteArray::number(statusCode) + " OK\r\n");
-	socket->write("Content-Type: application/json; charset=utf-8\r\n");
-	socket->write("Content-Length: " + QByteArray::number(body.size()) + "\r\n");
-	socket->write("Access-Control-Allow-Origin: *\r\n");
-	socket->write("Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n");
-	socket->write("Access-Control-Allow-Headers: Content-Type\r\n");
-	socket->write("Connection: close\r\n");
-	socket->write("\r\n");
-	socket->write(body);
+	// 不逐个 flush：流水线上的多个应答回到事件循环后合并成一次发送
+	socket->write(data);
+	if (!keepAlive)
+		socket->disconnectFromHost();
+}
+
+void HttpServer::sendStatic(QTcpSocket *socket, StaticResponse kind, bool keepAlive)
+{
+#ifdef XHS_HTTP_BASELINE_RESPONSES
+	const StaticResponseInfo &info = kStaticResponses[kind];
+	if (info.statusCode >= 400)
+		Metrics::instance().inc(Metrics::HttpErrors);
+	if (socket->state() != QAbstractSocket::ConnectedState)
+		return;
+	QByteArray body = QJsonDocument::fromJson(QByteArray(info.body)).toJson();
+	writeBaselineResponse(socket, info.statusCode, reasonPhrase(info.statusCode), body, keepAlive, kJsonContentType,
+			      info.extraHeaders, m_config);
+	if (!keepAlive)
+		socket->disconnectFromHost();
+#else
+	writeResponse(socket, kStaticResponses[kind].statusCode, m_staticResponses[kind][keepAlive ? 1 : 0],
+		      keepAlive);
+#endif
+}
+
+void HttpServer::sendResponse(QTcpSocket *socket, int statusCode, const QByteArray &body, bool keepAlive,
+			      const QByteArray &contentType)
+{
+#ifdef XHS_HTTP_BASELINE_RESPONSES
+	if (statusCode >= 400)
+		Metrics::instance().inc(Metrics::HttpErrors);
+	if (socket->state() != QAbstractSocket::ConnectedState)
+		return;
+	writeBaselineResponse(socket, statusCode, reasonPhrase(statusCode), body, keepAlive, contentType, nullptr,
+			      m_config);
+	if (!keepAlive)
+		socket->disconnectFromHost();
+#else
+	writeResponse(socket, statusCode, buildResponse(statusCode, body, keepAlive, contentType), keepAlive);
+#endif
+}
+
+void HttpServer::startEventStream(QTcpSocket *socket, Connection *conn)
+{
+	if (socket->state() != QAbstractSocket::ConnectedState)
+		return;
+
+	conn->streaming = true;
+	conn->idleTimer->stop();
+	m_eventClients.insert(socket);
+
+	QByteArray head = "HTTP/1.1 200 OK\r\n"
+			  "Content-Type: text/event-stream; charset=utf-8\r\n"
+			  "Cache-Control: no-cache\r\n"
+			  "Access-Control-Allow-Origin: " +
+			  m_config.httpCorsOrigin.toUtf8() +
+			  "\r\n"
+			  "Connection: keep-alive\r\n"
+			  "\r\n"
+			  // 断线后浏览器 EventSource 3 秒后自动重连
+			  "retry: 3000\n\n";
+	head += m_lastStatusEvent;
+	socket->write(head);
 	socket->flush();
-	socket->disconnectFromHost();
+
+	AudioController::instance().recordHeartbeat();
+}
+
+void HttpServer::onStatusChanged()
+{
+	// 多次变化排队到这里时只推送最新的一版
+	std::shared_ptr<const StatusSnapshot> snapshot = AudioController::instance().statusSnapshot();
+	if (snapshot->version == m_lastStatusVersion && !m_lastStatusEvent.isEmpty())
+		return;
+	m_lastStatusVersion = snapshot->version;
+
+	// 只在变化时推送，客户端按 nextTimeAt / nextNoiseAt (秒级时间戳) 自行倒计时
+	qint64 now = QDateTime::currentSecsSinceEpoch();
+	QJsonObject status;
+	status["version"] = qint64(snapshot->version);
+	status["type"] = snapshot->type;
+	status["queue"] = snapshot->queueDepth;
+	status["nextTime"] = snapshot->nextTimeTrigger - now;
+	status["nextNoise"] = snapshot->nextNoiseTrigger - now;
+	status["nextTimeAt"] = snapshot->nextTimeTrigger;
+	status["nextNoiseAt"] = snapshot->nextNoiseTrigger;
+	status["file"] = snapshot->currentFile;
+	status["enabled"] = snapshot->enabled;
+	status["connected"] = snapshot->connected;
+
+	m_lastStatusEvent = "event: status\ndata: " + QJsonDocument(status).toJson(QJsonDocument::Compact) + "\n\n";
+	// 遍历副本：写失败可能同步触发断开并修改订阅者集合
+	const QSet<QTcpSocket *> clients = m_eventClients;
+	for (QTcpSocket *socket : clients) {
+		socket->write(m_lastStatusEvent);
+		socket->flush();
+	}
+}
+
+void HttpServer::sendEventKeepAlive()
+{
+	if (m_eventClients.isEmpty())
+		return;
+
+	// 注释行保活：写失败会触发断开并移出订阅者；仍有订阅者即刷新心跳
+	const QSet<QTcpSocket *> clients = m_eventClients;
+	for (QTcpSocket *socket : clients) {
+		socket->write(": ping\n\n");
+		socket->flush();
+	}
+	AudioController::instance().recordHeartbeat();
 }
 
 void HttpServer::handleDisconnected()
 {
 	QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
-	if (socket)
-		socket->deleteLater();
-}
\ No newline at end of file
+	if (!socket)
+		return;
+	m_eventClients.remove(socket);
+	delete m_connections.take(socket);
+}
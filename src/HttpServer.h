@@ -2,12 +2,22 @@
 #include <QTcpServer>
 #include <QTcpSocket>
 #include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QJsonObject>
+#include <QHostAddress>
+#include <QUrlQuery>
+#include "Common.h"
+#include "HttpParser.h"
+#include "RequestDedupCache.h"
 
 class HttpServer : public QTcpServer {
 	Q_OBJECT
 public:
 	explicit HttpServer(QObject *parent = nullptr);
-	bool start(quint16 port = 18888);
+	~HttpServer();
+	bool start(const PluginConfig &config, quint16 port = 18888);
 
 protected:
 	void incomingConnection(qintptr socketDescriptor) override;
@@ -15,7 +25,72 @@ protected:
 private slots:
 	void handleReadyRead();
 	void handleDisconnected();
+	void onStatusChanged();
+	void sendEventKeepAlive();
+	void applyConfig(const PluginConfig &config);
 
 private:
-	void sendResponse(QTcpSocket *socket, int statusCode, const QByteArray &body);
+	// SSE 保活间隔，需小于控制器判定断线的 10 秒
+	static constexpr int kEventKeepAliveMs = 5000;
+
+	struct Connection {
+		HttpParser parser;
+		QTimer *idleTimer = nullptr;
+		bool readingRequest = false; // 计时器当前按读超时计，而不是空闲超时
+		bool streaming = false;      // 已切换为 /events 推送流
+	};
+
+	struct RateBucket {
+		double tokens = 0.0;
+		qint64 lastMs = 0;
+	};
+
+	void handleRequest(QTcpSocket *socket, const HttpRequest &request);
+	void handleBatchPlay(QTcpSocket *socket, const QByteArray &body, bool keepAlive);
+	void handlePlay(QTcpSocket *socket, const QUrlQuery &query, bool keepAlive);
+	// 固定内容的应答 (状态行 + 头 + 正文) 预先整段拼好，配置变更时重建
+	enum StaticResponse {
+		StaticOptions = 0,
+		StaticOnline,
+		StaticMissingPath,
+		StaticBadRequest,
+		StaticNotFound,
+		StaticMethodNotAllowed,
+		StaticRequestTimeout,
+		StaticPayloadTooLarge,
+		StaticRateLimited,
+		StaticHeadersTooLarge,
+		StaticNotImplemented,
+		StaticTooManyConnections,
+		StaticResponseCount
+	};
+
+	void sendResponse(QTcpSocket *socket, int statusCode, const QByteArray &body, bool keepAlive = true,
+			  const QByteArray &contentType = "application/json; charset=utf-8");
+	void sendStatic(QTcpSocket *socket, StaticResponse kind, bool keepAlive);
+	void writeResponse(QTcpSocket *socket, int statusCode, const QByteArray &data, bool keepAlive);
+	QByteArray buildResponse(int statusCode, const QByteArray &body, bool keepAlive, const QByteArray &contentType,
+				 const char *extraHeaders = nullptr) const;
+	void rebuildStaticResponses();
+	static const char *reasonPhrase(int statusCode);
+	void startEventStream(QTcpSocket *socket, Connection *conn);
+	void handleTimeout(QTcpSocket *socket);
+	void armTimer(Connection *conn, int timeoutMs);
+	bool allowRequest(const QHostAddress &peer);
+
+	// 服务线程持有的配置副本，不跨线程读取控制器的配置
+	PluginConfig m_config;
+	QHash<QTcpSocket *, Connection *> m_connections;
+	QHash<QString, RateBucket> m_rateBuckets;
+	RequestDedupCache m_dedup;
+
+	// [kind][keepAlive]，以及按连接方式区分的公共头尾部 (CORS、Connection)
+	QByteArray m_staticResponses[StaticResponseCount][2];
+	QByteArray m_headerTail[2];
+
+	// Server-Sent Events 订阅者，连接存活即视为浏览器在线
+	QSet<QTcpSocket *> m_eventClients;
+	QByteArray m_lastStatusEvent;
+	quint64 m_lastStatusVersion = 0;
+	QTimer *m_eventKeepAliveTimer;
 };
\ No newline at end of file
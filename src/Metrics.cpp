@@ -0,0 +1,167 @@
+﻿#include "Metrics.h"
+#include <QtAlgorithms>
+
+extern "C" {
+#include <util/platform.h>
+}
+
+LatencyHistogram::LatencyHistogram(const char *name, const char *help) : m_name(name), m_help(help)
+{
+	for (auto &bucket : m_buckets)
+		bucket.store(0, std::memory_order_relaxed);
+}
+
+int LatencyHistogram::bucketIndex(qint64 micros)
+{
+	if (micros < kLinearBuckets)
+		return micros < 0 ? 0 : int(micros);
+
+	int msb = 63 - int(qCountLeadingZeroBits(quint64(micros)));
+	if (msb > kMaxMsb)
+		return kBucketCount - 1;
+	// 取最高位以下 4 位作为区间内的细分格
+	int shift = msb - 4;
+	int top = int(micros >> shift); // [16, 31]
+	return kLinearBuckets + (msb - 5) * kSubBuckets + (top - kSubBuckets);
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int index)
+{
+	if (index < kLinearBuckets)
+		return index;
+	int group = (index - kLinearBuckets) / kSubBuckets;
+	int top = kSubBuckets + (index - kLinearBuckets) % kSubBuckets;
+	int shift = group + 1;
+	return ((qint64(top) + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(qint64 micros)
+{
+	if (micros < 0)
+		micros = 0;
+	m_buckets[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+	m_sum.fetch_add(quint64(micros), std::memory_order_relaxed);
+
+	qint64 prev = m_max.load(std::memory_order_relaxed);
+	while (micros > prev && !m_max.compare_exchange_weak(prev, micros, std::memory_order_relaxed)) {
+	}
+}
+
+qint64 LatencyHistogram::percentile(double q) const
+{
+	// 与 count 读取不是同一快照，导出时的轻微偏差可以接受
+	quint64 total = count();
+	if (total == 0)
+		return 0;
+
+	quint64 rank = quint64(q * double(total) + 0.5);
+	if (rank < 1)
+		rank = 1;
+	quint64 seen = 0;
+	for (int i = 0; i < kBucketCount; ++i) {
+		seen += m_buckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank)
+			return qMin(bucketUpperBound(i), m_max.load(std::memory_order_relaxed));
+	}
+	return m_max.load(std::memory_order_relaxed);
+}
+
+void LatencyHistogram::writePrometheus(QByteArray &out) const
+{
+	static const double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+	out += QByteArray("# HELP ") + m_name + " " + m_help + "\n";
+	out += QByteArray("# TYPE ") + m_name + " summary\n";
+	for (double q : kQuantiles) {
+		out += QByteArray(m_name) + "{quantile=\"" + QByteArray::number(q) + "\"} " +
+		       QByteArray::number(double(percentile(q)) / 1e6, 'g', 9) + "\n";
+	}
+	out += QByteArray(m_name) + "_sum " +
+	       QByteArray::number(double(m_sum.load(std::memory_order_relaxed)) / 1e6, 'g', 12) + "\n";
+	out += QByteArray(m_name) + "_count " + QByteArray::number(count()) + "\n";
+}
+
+namespace {
+struct CounterInfo {
+	const char *name;
+	const char *help;
+};
+
+const CounterInfo kCounterInfo[Metrics::CounterCount] = {
+	{"xhs_http_requests_total", "HTTP requests handled."},
+	{"xhs_http_errors_total", "HTTP responses with status >= 400."},
+	{"xhs_tasks_enqueued_total", "Audio tasks added to the playback queue."},
+	{"xhs_tasks_dropped_total", "Audio tasks dropped after missing their deadline."},
+	{"xhs_tasks_preempted_total", "Noise clips cut off by a reply."},
+	{"xhs_playback_started_total", "Clips handed to the media source."},
+	{"xhs_playback_timeouts_total", "Clips skipped by the 60 second playback watchdog."},
+};
+}
+
+Metrics &Metrics::instance()
+{
+	static Metrics metrics;
+	return metrics;
+}
+
+qint64 Metrics::nowMicros()
+{
+	return qint64(os_gettime_ns() / 1000);
+}
+
+Metrics::Metrics()
+{
+	for (auto &counter : m_counters)
+		counter.store(0, std::memory_order_relaxed);
+
+	m_histograms[HttpHandle] =
+		new LatencyHistogram("xhs_http_handle_seconds", "Time from a complete request to the response write.");
+	m_histograms[Enqueue] =
+		new LatencyHistogram("xhs_enqueue_seconds", "Time to resolve an audio path and publish the task.");
+	m_histograms[QueueWait] =
+		new LatencyHistogram("xhs_queue_wait_seconds", "Time a task waited in the queue before playback.");
+	m_histograms[MediaOpen] =
+		new LatencyHistogram("xhs_media_open_seconds", "Time from loading a file to the media_started signal.");
+	m_histograms[ReplyEndToEnd] =
+		new LatencyHistogram("xhs_reply_end_to_end_seconds", "Time from reply enqueue to audible playback.");
+	m_histograms[DuckRamp] =
+		new LatencyHistogram("xhs_duck_ramp_seconds", "Wall time taken by a ducking ramp to complete.");
+}
+
+Metrics::~Metrics()
+{
+	for (LatencyHistogram *histogram : m_histograms)
+		delete histogram;
+}
+
+void Metrics::observeQueueDepth(int depth)
+{
+	int prev = m_queueDepthMax.load(std::memory_order_relaxed);
+	while (depth > prev && !m_queueDepthMax.compare_exchange_weak(prev, depth, std::memory_order_relaxed)) {
+	}
+}
+
+QByteArray Metrics::exportPrometheus(int queueDepth) const
+{
+	QByteArray out;
+	out.reserve(8192);
+
+	for (int i = 0; i < CounterCount; ++i) {
+		out += QByteArray("# HELP ") + kCounterInfo[i].name + " " + kCounterInfo[i].help + "\n";
+		out += QByteArray("# TYPE ") + kCounterInfo[i].name + " counter\n";
+		out += QByteArray(kCounterInfo[i].name) + " " +
+		       QByteArray::number(m_counters[i].load(std::memory_order_relaxed)) + "\n";
+	}
+
+	out += "# HELP xhs_queue_depth Tasks waiting in the playback queue.\n";
+	out += "# TYPE xhs_queue_depth gauge\n";
+	out += "xhs_queue_depth " + QByteArray::number(queueDepth) + "\n";
+	out += "# HELP xhs_queue_depth_max Deepest playback queue seen since load.\n";
+	out += "# TYPE xhs_queue_depth_max gauge\n";
+	out += "xhs_queue_depth_max " + QByteArray::number(m_queueDepthMax.load(std::memory_order_relaxed)) + "\n";
+
+	for (const LatencyHistogram *histogram : m_histograms)
+		histogram->writePrometheus(out);
+	return out;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <QByteArray>
+#include <atomic>
+
+// HDR 风格延迟直方图 (微秒)
+// 小于 32us 逐个计数，之后每个 2 的幂区间再线性细分 16 格，相对误差不超过 1/16
+// 记录只做几次原子加，可在任意线程调用
+class LatencyHistogram {
+public:
+	LatencyHistogram(const char *name, const char *help);
+
+	void record(qint64 micros);
+	quint64 count() const { return m_count.load(std::memory_order_relaxed); }
+	qint64 percentile(double q) const;
+
+	// Prometheus summary 格式 (秒)
+	void writePrometheus(QByteArray &out) const;
+
+private:
+	static constexpr int kLinearBuckets = 32;
+	static constexpr int kSubBuckets = 16;
+	static constexpr int kMaxMsb = 40; // 约 12 天，超出的值压到最后一格
+	static constexpr int kBucketCount = kLinearBuckets + (kMaxMsb - 4) * kSubBuckets;
+
+	static int bucketIndex(qint64 micros);
+	static qint64 bucketUpperBound(int index);
+
+	const char *m_name;
+	const char *m_help;
+	std::atomic<quint64> m_buckets[kBucketCount];
+	std::atomic<quint64> m_count{0};
+	std::atomic<quint64> m_sum{0};
+	std::atomic<qint64> m_max{0};
+};
+
+// 插件全局指标：HTTP 处理、入队、排队等待、媒体打开和闪避渐变
+class Metrics {
+public:
+	enum Counter {
+		HttpRequests = 0,
+		HttpErrors,
+		TasksEnqueued,
+		TasksDropped,
+		TasksPreempted,
+		PlaybackStarted,
+		PlaybackTimeouts,
+		CounterCount
+	};
+
+	enum Histogram {
+		HttpHandle = 0, // 请求完整到达 -> 应答写出
+		Enqueue,        // 解析路径、选文件并入队
+		QueueWait,      // 入队 -> 出队开播
+		MediaOpen,      // 下发文件 -> 媒体源报告 started
+		ReplyEndToEnd,  // 回复入队 -> 真正出声
+		DuckRamp,       // 闪避渐变实际完成耗时
+		HistogramCount
+	};
+
+	static Metrics &instance();
+	static qint64 nowMicros();
+
+	void inc(Counter counter, quint64 n = 1) { m_counters[counter].fetch_add(n, std::memory_order_relaxed); }
+	void record(Histogram histogram, qint64 micros) { m_histograms[histogram]->record(micros); }
+	void observeQueueDepth(int depth);
+
+	QByteArray exportPrometheus(int queueDepth) const;
+
+private:
+	Metrics();
+	~Metrics();
+
+	std::atomic<quint64> m_counters[CounterCount];
+	LatencyHistogram *m_histograms[HistogramCount];
+	std::atomic<int> m_queueDepthMax{0};
+};
@@ -0,0 +1,363 @@
+﻿#include "PcmAudioSource.h"
+#include "WavFormat.h"
+#include <QFile>
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <obs-module.h>
+#include <util/platform.h>
+#include <util/util_uint64.h>
+}
+
+// 送数线程最多领先播放时间轴的时长；最后一块送出后等排队的这段播完再报告结束，
+// 期间收到的下一段仍接在同一时间轴上，做到零间隙
+static const uint64_t kLeadNs = 60000000ULL;
+// 每次推送 10ms 的音频
+static const uint32_t kChunksPerSecond = 100;
+
+class PcmFeeder {
+public:
+	explicit PcmFeeder(obs_source_t *source) : m_source(source) { m_thread = std::thread(&PcmFeeder::run, this); }
+
+	~PcmFeeder()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_cv.notify_all();
+		m_thread.join();
+	}
+
+	void play(const QString &path)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_pendingPath = path;
+			m_hasPending = true;
+			m_paused = false;
+		}
+		m_cv.notify_all();
+	}
+
+	void stop() { play(QString()); }
+
+	void restart()
+	{
+		QString path;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			path = m_currentPath;
+		}
+		if (!path.isEmpty())
+			play(path);
+	}
+
+	void setPaused(bool paused)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_paused = paused;
+		}
+		m_cv.notify_all();
+	}
+
+	void seek(int64_t ms)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_seekMs = ms < 0 ? 0 : ms;
+		}
+		m_cv.notify_all();
+	}
+
+	enum obs_media_state state() const { return m_state.load(); }
+	int64_t timeMs() const { return m_timeMs.load(); }
+	int64_t durationMs() const { return m_durationMs.load(); }
+
+private:
+	static bool toObsFormat(const WavInfo &info, enum audio_format &format, enum speaker_layout &speakers)
+	{
+		// EXTENSIBLE 文件按 SubFormat 区分整数与浮点
+		bool isFloat = info.subFormat == 3;
+		bool isPcm = info.subFormat == 1;
+		if (isFloat && info.bitsPerSample == 32)
+			format = AUDIO_FORMAT_FLOAT;
+		else if (isPcm && info.bitsPerSample == 8)
+			format = AUDIO_FORMAT_U8BIT;
+		else if (isPcm && info.bitsPerSample == 16)
+			format = AUDIO_FORMAT_16BIT;
+		else if (isPcm && info.bitsPerSample == 32)
+			format = AUDIO_FORMAT_32BIT;
+		else
+			return false;
+
+		switch (info.numChannels) {
+		case 1:
+			speakers = SPEAKERS_MONO;
+			break;
+		case 2:
+			speakers = SPEAKERS_STEREO;
+			break;
+		case 3:
+			speakers = SPEAKERS_2POINT1;
+			break;
+		case 4:
+			speakers = SPEAKERS_4POINT0;
+			break;
+		case 5:
+			speakers = SPEAKERS_4POINT1;
+			break;
+		case 6:
+			speakers = SPEAKERS_5POINT1;
+			break;
+		case 8:
+			speakers = SPEAKERS_7POINT1;
+			break;
+		default:
+			return false;
+		}
+		return info.sampleRate > 0 && info.blockAlign > 0;
+	}
+
+	void run()
+	{
+		std::vector<uint8_t> buffer;
+
+		for (;;) {
+			QString path;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cv.wait(lock, [this]() { return m_quit || m_hasPending; });
+				if (m_quit)
+					return;
+				path = m_pendingPath;
+				m_hasPending = false;
+				m_seekMs = -1;
+				m_currentPath = path;
+			}
+
+			if (path.isEmpty()) {
+				m_state = OBS_MEDIA_STATE_STOPPED;
+				m_timeMs = 0;
+				m_durationMs = 0;
+				continue;
+			}
+
+			playClip(path, buffer);
+		}
+	}
+
+	void playClip(const QString &path, std::vector<uint8_t> &buffer)
+	{
+		QFile file(path);
+		WavInfo info;
+		enum audio_format format;
+		enum speaker_layout speakers;
+		if (!file.open(QIODevice::ReadOnly) || !readWavInfo(file, info) || !toObsFormat(info, format, speakers)) {
+			blog(LOG_WARNING, "[智播精灵] 内置音频源无法播放 (仅支持 8/16/32 位整数或 32 位浮点 WAV): %s",
+			     path.toUtf8().constData());
+			m_state = OBS_MEDIA_STATE_ERROR;
+			return;
+		}
+
+		const uint32_t framesPerChunk = qMax<uint32_t>(1, info.sampleRate / kChunksPerSecond);
+		const uint64_t totalFrames = info.dataSize / info.blockAlign;
+		buffer.resize((size_t)framesPerChunk * info.blockAlign);
+
+		m_durationMs = (int64_t)util_mul_div64(totalFrames, 1000, info.sampleRate);
+		m_timeMs = 0;
+
+		// 上一段刚结束且时间轴还在前方时直接续接，否则从当前时刻重新起算
+		uint64_t now = os_gettime_ns();
+		uint64_t clipStartTs = m_nextTs > now ? m_nextTs : now;
+		uint64_t frame = 0;
+
+		m_state = OBS_MEDIA_STATE_PLAYING;
+		obs_source_media_started(m_source);
+
+		while (frame < totalFrames) {
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				if (m_paused) {
+					m_state = OBS_MEDIA_STATE_PAUSED;
+					m_cv.wait(lock, [this]() { return m_quit || m_hasPending || !m_paused || m_seekMs >= 0; });
+					if (!m_paused && !m_hasPending && !m_quit) {
+						// 暂停期间时间轴停走，恢复后从当前时刻续上
+						m_state = OBS_MEDIA_STATE_PLAYING;
+						clipStartTs = os_gettime_ns() - util_mul_div64(frame, 1000000000ULL, info.sampleRate);
+					}
+				}
+				if (m_quit || m_hasPending)
+					return; // 被新片段或停止打断
+				if (m_seekMs >= 0) {
+					frame = qMin<uint64_t>(util_mul_div64(m_seekMs, info.sampleRate, 1000), totalFrames);
+					clipStartTs = os_gettime_ns() - util_mul_div64(frame, 1000000000ULL, info.sampleRate);
+					m_seekMs = -1;
+				}
+				if (m_paused)
+					continue;
+			}
+
+			uint32_t frames = (uint32_t)qMin<uint64_t>(framesPerChunk, totalFrames - frame);
+			qint64 bytes = (qint64)frames * info.blockAlign;
+			if (!file.seek(info.dataOffset + (qint64)frame * info.blockAlign) ||
+			    file.read(reinterpret_cast<char *>(buffer.data()), bytes) != bytes)
+				break;
+
+			uint64_t ts = clipStartTs + util_mul_div64(frame, 1000000000ULL, info.sampleRate);
+
+			struct obs_source_audio audio = {};
+			audio.data[0] = buffer.data();
+			audio.frames = frames;
+			audio.speakers = speakers;
+			audio.format = format;
+			audio.samples_per_sec = info.sampleRate;
+			audio.timestamp = ts;
+			obs_source_output_audio(m_source, &audio);
+
+			frame += frames;
+			m_nextTs = clipStartTs + util_mul_div64(frame, 1000000000ULL, info.sampleRate);
+			m_timeMs = (int64_t)util_mul_div64(frame, 1000, info.sampleRate);
+
+			// 只领先播放位置 kLeadNs，保持推送节奏
+			if (m_nextTs > kLeadNs)
+				os_sleepto_ns(m_nextTs - kLeadNs);
+		}
+
+		// 最后送出的最多 kLeadNs 音频还在 OBS 里排队；控制器收到结束后会静音、重置源，
+		// 提前报告会截掉尾音，所以等时间轴走到片段末尾 (被新片段或停止打断则直接返回)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			uint64_t now = os_gettime_ns();
+			if (m_nextTs > now)
+				m_cv.wait_for(lock, std::chrono::nanoseconds(m_nextTs - now),
+					      [this]() { return m_quit || m_hasPending; });
+			if (m_quit || m_hasPending)
+				return;
+		}
+
+		m_state = OBS_MEDIA_STATE_ENDED;
+		obs_source_media_ended(m_source);
+	}
+
+	obs_source_t *m_source;
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+
+	bool m_quit = false;
+	bool m_hasPending = false;
+	bool m_paused = false;
+	int64_t m_seekMs = -1;
+	QString m_pendingPath;
+	QString m_currentPath;
+
+	// 仅送数线程读写
+	uint64_t m_nextTs = 0;
+
+	std::atomic<enum obs_media_state> m_state{OBS_MEDIA_STATE_NONE};
+	std::atomic<int64_t> m_timeMs{0};
+	std::atomic<int64_t> m_durationMs{0};
+};
+
+static const char *pcm_source_get_name(void *)
+{
+	return "智播精灵音频源";
+}
+
+static void pcm_source_update(void *data, obs_data_t *settings)
+{
+	PcmFeeder *feeder = static_cast<PcmFeeder *>(data);
+	const char *file = obs_data_get_string(settings, "local_file");
+	feeder->play(QString::fromUtf8(file ? file : ""));
+}
+
+static void *pcm_source_create(obs_data_t *settings, obs_source_t *source)
+{
+	PcmFeeder *feeder = new PcmFeeder(source);
+	pcm_source_update(feeder, settings);
+	return feeder;
+}
+
+static void pcm_source_destroy(void *data)
+{
+	delete static_cast<PcmFeeder *>(data);
+}
+
+static obs_properties_t *pcm_source_properties(void *)
+{
+	obs_properties_t *props = obs_properties_create();
+	obs_properties_add_path(props, "local_file", "WAV 文件", OBS_PATH_FILE, "WAV (*.wav)", nullptr);
+	return props;
+}
+
+static void pcm_source_play_pause(void *data, bool pause)
+{
+	static_cast<PcmFeeder *>(data)->setPaused(pause);
+}
+
+static void pcm_source_restart(void *data)
+{
+	static_cast<PcmFeeder *>(data)->restart();
+}
+
+static void pcm_source_stop(void *data)
+{
+	static_cast<PcmFeeder *>(data)->stop();
+}
+
+static int64_t pcm_source_get_time(void *data)
+{
+	return static_cast<PcmFeeder *>(data)->timeMs();
+}
+
+static int64_t pcm_source_get_duration(void *data)
+{
+	return static_cast<PcmFeeder *>(data)->durationMs();
+}
+
+static void pcm_source_set_time(void *data, int64_t ms)
+{
+	static_cast<PcmFeeder *>(data)->seek(ms);
+}
+
+static enum obs_media_state pcm_source_get_state(void *data)
+{
+	return static_cast<PcmFeeder *>(data)->state();
+}
+
+void registerPcmAudioSource()
+{
+	struct obs_source_info info = {};
+	info.id = XHS_PCM_SOURCE_ID;
+	info.type = OBS_SOURCE_TYPE_INPUT;
+	info.output_flags = OBS_SOURCE_AUDIO | OBS_SOURCE_CONTROLLABLE_MEDIA;
+	info.icon_type = OBS_ICON_TYPE_AUDIO_OUTPUT;
+	info.get_name = pcm_source_get_name;
+	info.create = pcm_source_create;
+	info.destroy = pcm_source_destroy;
+	info.update = pcm_source_update;
+	info.get_properties = pcm_source_properties;
+	info.media_play_pause = pcm_source_play_pause;
+	info.media_restart = pcm_source_restart;
+	info.media_stop = pcm_source_stop;
+	info.media_get_time = pcm_source_get_time;
+	info.media_get_duration = pcm_source_get_duration;
+	info.media_set_time = pcm_source_set_time;
+	info.media_get_state = pcm_source_get_state;
+	obs_register_source(&info);
+}
+
+bool isPcmAudioSource(obs_source_t *source)
+{
+	const char *id = source ? obs_source_get_id(source) : nullptr;
+	return id && strcmp(id, XHS_PCM_SOURCE_ID) == 0;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+struct obs_source;
+
+// 插件自带的音频源：直接读取 WAV 的 PCM 数据，由独立送数线程推给 OBS 混音
+// 不经过 ffmpeg_source，每段音频没有解复用/解码器的启动开销，片段之间按采样精度首尾相接
+// 设置项与 ffmpeg_source 一致 (local_file)，控制器无需区分即可驱动
+#define XHS_PCM_SOURCE_ID "xhs_guard_pcm_source"
+
+void registerPcmAudioSource();
+bool isPcmAudioSource(struct obs_source *source);
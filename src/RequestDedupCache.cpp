@@ -0,0 +1,53 @@
+﻿#include "RequestDedupCache.h"
+
+RequestDedupCache::RequestDedupCache(int capacity) : m_capacity(qMax(1, capacity)) {}
+
+bool RequestDedupCache::lookup(const QString &key, qint64 now, Entry &entry)
+{
+	if (key.isEmpty())
+		return false;
+	auto it = m_entries.constFind(key);
+	if (it == m_entries.constEnd() || it->expiresAt <= now)
+		return false;
+	entry = *it;
+	return true;
+}
+
+void RequestDedupCache::insert(const QString &key, int statusCode, const QJsonObject &response, qint64 now, int ttlMs)
+{
+	if (key.isEmpty() || ttlMs <= 0)
+		return;
+
+	evict(now);
+
+	Entry entry;
+	entry.statusCode = statusCode;
+	entry.response = response;
+	entry.expiresAt = now + ttlMs;
+	// 重复插入的键移到队尾，按最新的过期时间排队
+	if (m_entries.contains(key))
+		m_order.removeOne(key);
+	m_order.enqueue(key);
+	m_entries.insert(key, entry);
+}
+
+void RequestDedupCache::evict(qint64 now)
+{
+	// 队首已过期或超出容量就出队
+	while (!m_order.isEmpty()) {
+		const QString &key = m_order.head();
+		auto it = m_entries.find(key);
+		bool expired = it == m_entries.end() || it->expiresAt <= now;
+		if (!expired && m_entries.size() < m_capacity)
+			break;
+		if (it != m_entries.end())
+			m_entries.erase(it);
+		m_order.dequeue();
+	}
+}
+
+void RequestDedupCache::clear()
+{
+	m_entries.clear();
+	m_order.clear();
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <QHash>
+#include <QJsonObject>
+#include <QQueue>
+#include <QString>
+
+// /play 请求去重缓存：按 request_id 或相同路径记住最近的应答，重试时原样返回而不再入队
+// 容量有限且条目按时间过期；只在 HTTP 服务线程上使用，不加锁
+class RequestDedupCache {
+public:
+	struct Entry {
+		int statusCode = 0;
+		QJsonObject response;
+		qint64 expiresAt = 0; // ms
+	};
+
+	explicit RequestDedupCache(int capacity = 512);
+
+	bool lookup(const QString &key, qint64 now, Entry &entry);
+	void insert(const QString &key, int statusCode, const QJsonObject &response, qint64 now, int ttlMs);
+	void clear();
+
+private:
+	void evict(qint64 now);
+
+	int m_capacity;
+	QHash<QString, Entry> m_entries;
+	QQueue<QString> m_order; // 插入顺序，最早的先淘汰
+};
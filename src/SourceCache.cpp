@@ -0,0 +1,146 @@
+﻿#include "SourceCache.h"
+
+extern "C" {
+#include <obs.h>
+}
+
+SourceCache::SourceCache(QObject *parent) : QObject(parent) {}
+
+SourceCache::~SourceCache()
+{
+	// 正常情况下 shutdown 时已经 detach；这里只是兜底，缓存只在挂接期间存在
+	detach();
+}
+
+void SourceCache::attach()
+{
+	{
+		QMutexLocker locker(&m_mutex);
+		if (m_attached)
+			return;
+		m_attached = true;
+	}
+	signal_handler_t *sh = obs_get_signal_handler();
+	signal_handler_connect(sh, "source_create", onSourceCreate, this);
+	signal_handler_connect(sh, "source_remove", onSourceRemove, this);
+	signal_handler_connect(sh, "source_destroy", onSourceRemove, this);
+	signal_handler_connect(sh, "source_rename", onSourceRename, this);
+}
+
+void SourceCache::detach()
+{
+	{
+		QMutexLocker locker(&m_mutex);
+		if (!m_attached)
+			return;
+		m_attached = false;
+	}
+	signal_handler_t *sh = obs_get_signal_handler();
+	if (sh) {
+		signal_handler_disconnect(sh, "source_create", onSourceCreate, this);
+		signal_handler_disconnect(sh, "source_remove", onSourceRemove, this);
+		signal_handler_disconnect(sh, "source_destroy", onSourceRemove, this);
+		signal_handler_disconnect(sh, "source_rename", onSourceRename, this);
+	}
+	// 弱引用在 libobs 仍存活时释放，不留给静态析构
+	clear();
+}
+
+obs_source_t *SourceCache::acquire(const QString &name)
+{
+	if (name.isEmpty())
+		return nullptr;
+
+	{
+		QMutexLocker locker(&m_mutex);
+		auto it = m_handles.find(name);
+		if (it != m_handles.end()) {
+			obs_source_t *source = obs_weak_source_get_source(it.value());
+			if (source)
+				return source;
+			// 源已销毁，丢弃失效句柄后重新解析
+			obs_weak_source_release(it.value());
+			m_handles.erase(it);
+		} else if (m_missing.contains(name)) {
+			return nullptr;
+		}
+	}
+
+	// 全局查找会占用 libobs 的锁，放在缓存锁外面做，避免与信号回调互相等待
+	obs_source_t *source = obs_get_source_by_name(name.toUtf8().constData());
+
+	QMutexLocker locker(&m_mutex);
+	// 未挂接信号时无法得知源的改名和移除，不缓存
+	if (!m_attached)
+		return source;
+	if (!source) {
+		m_missing.insert(name);
+		return nullptr;
+	}
+	if (!m_handles.contains(name))
+		m_handles.insert(name, obs_source_get_weak_source(source));
+	return source;
+}
+
+void SourceCache::onSourceCreate(void *data, calldata_t *)
+{
+	SourceCache *self = static_cast<SourceCache *>(data);
+	QMutexLocker locker(&self->m_mutex);
+	self->m_missing.clear();
+}
+
+void SourceCache::onSourceRemove(void *data, calldata_t *cd)
+{
+	SourceCache *self = static_cast<SourceCache *>(data);
+	obs_source_t *source = static_cast<obs_source_t *>(calldata_ptr(cd, "source"));
+	if (source)
+		self->dropSource(source);
+}
+
+void SourceCache::onSourceRename(void *data, calldata_t *cd)
+{
+	SourceCache *self = static_cast<SourceCache *>(data);
+	QString prevName = QString::fromUtf8(calldata_string(cd, "prev_name"));
+	QString newName = QString::fromUtf8(calldata_string(cd, "new_name"));
+
+	{
+		QMutexLocker locker(&self->m_mutex);
+		// 新名字此前可能被记为找不到 (整表清空也覆盖了它)
+		self->m_missing.clear();
+
+		// 句柄跟随源改名，旧名称不再指向它
+		obs_weak_source_t *weak = self->m_handles.take(prevName);
+		if (weak) {
+			obs_weak_source_t *stale = self->m_handles.take(newName);
+			if (stale)
+				obs_weak_source_release(stale);
+			self->m_handles.insert(newName, weak);
+		}
+	}
+
+	// 不论是否解析过都要通知：尚未播放过的媒体源、尚未压低过的闪避源也得跟着改名，
+	// 是否影响配置由接收方判断
+	emit self->sourceRenamed(prevName, newName);
+}
+
+void SourceCache::dropSource(obs_source_t *source)
+{
+	QMutexLocker locker(&m_mutex);
+	for (auto it = m_handles.begin(); it != m_handles.end();) {
+		if (obs_weak_source_references_source(it.value(), source)) {
+			obs_weak_source_release(it.value());
+			it = m_handles.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void SourceCache::clear()
+{
+	QMutexLocker locker(&m_mutex);
+	for (obs_weak_source_t *weak : m_handles)
+		obs_weak_source_release(weak);
+	m_handles.clear();
+	m_missing.clear();
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+struct calldata;
+struct obs_source;
+struct obs_weak_source;
+
+// OBS 源句柄缓存：按名称解析一次后保存弱引用，热路径不再做 UTF-8 转换和全局查找
+// 通过全局信号跟踪源的创建、改名和移除；信号来自 OBS 线程，内部加锁
+class SourceCache : public QObject {
+	Q_OBJECT
+public:
+	explicit SourceCache(QObject *parent = nullptr);
+	~SourceCache();
+
+	void attach(); // 挂接 OBS 全局信号，需在 libobs 初始化之后调用
+	// 断开信号并释放全部弱引用，须在 libobs 关闭前调用 (不要留到静态析构)；
+	// 断开后 acquire 仍可用，但不再缓存
+	void detach();
+
+	// 返回强引用 (调用方负责 obs_source_release)，找不到返回 nullptr
+	struct obs_source *acquire(const QString &name);
+
+signals:
+	// 任何源改名都会发出 (不限于缓存过的源)；在 OBS 线程发出，接收方请使用队列连接
+	void sourceRenamed(const QString &prevName, const QString &newName);
+
+private:
+	static void onSourceCreate(void *data, struct calldata *cd);
+	static void onSourceRemove(void *data, struct calldata *cd);
+	static void onSourceRename(void *data, struct calldata *cd);
+
+	void dropSource(struct obs_source *source);
+	void clear();
+
+	QMutex m_mutex;
+	QHash<QString, struct obs_weak_source *> m_handles;
+	// 查找失败的名称，避免每次都做全局查找；有源创建或改名时清空
+	QSet<QString> m_missing;
+	bool m_attached = false; // 受 m_mutex 保护
+};
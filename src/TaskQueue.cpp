@@ -0,0 +1,171 @@
+﻿#include "TaskQueue.h"
+#include <algorithm>
+
+TaskQueue::TaskQueue()
+{
+	for (LaneQueue &lane : m_lanes) {
+		Node *stub = new Node();
+		lane.head.store(stub);
+		lane.tail = stub;
+	}
+}
+
+TaskQueue::~TaskQueue()
+{
+	for (LaneQueue &lane : m_lanes) {
+		Node *n = lane.tail;
+		while (n) {
+			Node *next = n->next.load();
+			delete n;
+			n = next;
+		}
+	}
+}
+
+TaskQueue::Lane TaskQueue::laneFor(const QString &type)
+{
+	if (type == "reply")
+		return LaneReply;
+	if (type == "time")
+		return LaneTime;
+	return LaneNoise;
+}
+
+void TaskQueue::push(const AudioTask &task)
+{
+	// 节点在入队前完全构造好，发布只需一次交换 + 一次 release 存储
+	Node *node = new Node();
+	node->task = task;
+	node->seq = m_seq.fetch_add(1);
+
+	LaneQueue &lane = m_lanes[laneFor(task.type)];
+	Node *prev = lane.head.exchange(node, std::memory_order_acq_rel);
+	prev->next.store(node, std::memory_order_release);
+
+	lane.size.fetch_add(1);
+	m_size.fetch_add(1);
+}
+
+void TaskQueue::pushBatch(const QList<AudioTask> &tasks)
+{
+	if (tasks.isEmpty())
+		return;
+
+	quint64 seq = m_seq.fetch_add(quint64(tasks.size()));
+
+	// 先在本地按道串好子链，再逐道发布
+	Node *first[LaneCount] = {};
+	Node *last[LaneCount] = {};
+	int count[LaneCount] = {};
+	for (const AudioTask &task : tasks) {
+		Node *node = new Node();
+		node->task = task;
+		node->seq = seq++;
+
+		int lane = laneFor(task.type);
+		if (last[lane])
+			last[lane]->next.store(node, std::memory_order_relaxed);
+		else
+			first[lane] = node;
+		last[lane] = node;
+		++count[lane];
+	}
+
+	// 发布期间消费者不出队：批内各道子链的序号可能交错，逐道发布时不能让消费者先取到批内靠后的任务
+	m_batchesInFlight.fetch_add(1);
+
+	// 按各道首个序号从小到大发布：消费者看到某道的节点时，序号更小的道必然已经发布 (见 frontLane)
+	int order[LaneCount];
+	int lanes = 0;
+	for (int i = 0; i < LaneCount; ++i) {
+		if (first[i])
+			order[lanes++] = i;
+	}
+	std::sort(order, order + lanes, [&first](int a, int b) { return first[a]->seq < first[b]->seq; });
+
+	for (int k = 0; k < lanes; ++k) {
+		int i = order[k];
+		Node *prev = m_lanes[i].head.exchange(last[i], std::memory_order_acq_rel);
+		prev->next.store(first[i], std::memory_order_release);
+		m_lanes[i].size.fetch_add(count[i]);
+	}
+	m_size.fetch_add(tasks.size());
+	m_batchesInFlight.fetch_sub(1);
+}
+
+int TaskQueue::frontLane(bool deferNoise) const
+{
+	int best = -1;
+	quint64 bestSeq = 0;
+	bool seen[LaneCount] = {};
+
+	if (m_batchesInFlight.load(std::memory_order_acquire) > 0)
+		return -1;
+
+	auto better = [&](int lane, quint64 seq) {
+		if (best < 0)
+			return true;
+		if (deferNoise && (lane == LaneNoise) != (best == LaneNoise))
+			return best == LaneNoise;
+		return seq < bestSeq;
+	};
+
+	// 第一遍选出候选后，再补看一遍第一遍为空的道：
+	// 对候选节点的 acquire 读取保证了同一生产者先发布的道此时一定可见，
+	// 批量入队跨道时不会先取到批内序号更大的任务
+	for (int pass = 0; pass < 2; ++pass) {
+		for (int i = 0; i < LaneCount; ++i) {
+			if (seen[i])
+				continue;
+			// 生产者交换 head 后、链接 next 前的瞬间，该道暂时看起来为空，下一轮再取即可
+			Node *next = m_lanes[i].tail->next.load(std::memory_order_acquire);
+			if (!next)
+				continue;
+			seen[i] = true;
+			if (better(i, next->seq)) {
+				best = i;
+				bestSeq = next->seq;
+			}
+		}
+		if (best < 0)
+			break;
+	}
+	return best;
+}
+
+bool TaskQueue::peek(AudioTask &task, bool deferNoise) const
+{
+	int lane = frontLane(deferNoise);
+	if (lane < 0)
+		return false;
+	task = m_lanes[lane].tail->next.load(std::memory_order_acquire)->task;
+	return true;
+}
+
+bool TaskQueue::pop(AudioTask &task, bool deferNoise)
+{
+	int laneIndex = frontLane(deferNoise);
+	if (laneIndex < 0)
+		return false;
+
+	LaneQueue &lane = m_lanes[laneIndex];
+	Node *tail = lane.tail;
+	Node *next = tail->next.load(std::memory_order_acquire);
+
+	// 取出的节点成为新的哑节点，旧哑节点释放
+	task = std::move(next->task);
+	next->task = AudioTask();
+	lane.tail = next;
+	delete tail;
+
+	lane.size.fetch_sub(1);
+	m_size.fetch_sub(1);
+	return true;
+}
+
+void TaskQueue::clear()
+{
+	AudioTask discard;
+	while (pop(discard)) {
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <QString>
+#include <QList>
+#include <atomic>
+#include "Common.h"
+
+// 无锁多生产者/单消费者任务队列，按 reply/time/noise 分道
+// 生产者 (HTTP、后台 I/O 线程、定时器) 入队只做一次原子交换，不与播放线程争锁
+// peek/pop/clear 只能在消费者 (控制器) 线程调用；跨道按入队序号保持整体先进先出
+class TaskQueue {
+public:
+	enum Lane { LaneReply = 0, LaneTime, LaneNoise, LaneCount };
+
+	TaskQueue();
+	~TaskQueue();
+	TaskQueue(const TaskQueue &) = delete;
+	TaskQueue &operator=(const TaskQueue &) = delete;
+
+	static Lane laneFor(const QString &type);
+
+	void push(const AudioTask &task);
+	// 批量入队：整批占用连续序号，每条道的子链一次交换发布；发布期间消费者暂停出队，
+	// 不会先取到批内靠后的任务。不同生产者之间只保证各道内的顺序：
+	// 某道上另一生产者发布到一半时，该道后面的任务会暂时被挡住，其他道的任务可能先出队
+	void pushBatch(const QList<AudioTask> &tasks);
+
+	// deferNoise: 只要 reply/time 道还有任务，就先于 noise 道出队
+	bool peek(AudioTask &task, bool deferNoise = false) const;
+	bool pop(AudioTask &task, bool deferNoise = false);
+	// 是否有已完整发布、可以立即取出的任务；size() 非零但这里为 false 说明有生产者正在发布，
+	// 它发布完成后会自行调度消费者
+	bool hasReady() const { return frontLane(false) >= 0; }
+	void clear();
+
+	// 近似值，任意线程可读
+	int size() const { return m_size.load(); }
+	bool isEmpty() const { return m_size.load() == 0; }
+	int laneSize(Lane lane) const { return m_lanes[lane].size.load(); }
+
+private:
+	struct Node {
+		std::atomic<Node *> next{nullptr};
+		AudioTask task;
+		quint64 seq = 0;
+	};
+
+	// Vyukov 式 MPSC 队列：head 由生产者交换，tail 只由消费者推进，tail 始终是哑节点
+	struct LaneQueue {
+		std::atomic<Node *> head{nullptr};
+		Node *tail = nullptr;
+		std::atomic<int> size{0};
+	};
+
+	// 找出队首序号最小的道，没有可取任务时返回 -1
+	int frontLane(bool deferNoise) const;
+
+	LaneQueue m_lanes[LaneCount];
+	std::atomic<quint64> m_seq{0};
+	std::atomic<int> m_size{0};
+	std::atomic<int> m_batchesInFlight{0};
+};
@@ -0,0 +1,237 @@
+﻿#include "TimeAnnouncementCache.h"
+#include "VoicePackIndex.h"
+#include "WavFormat.h"
+#include "EventLog.h"
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+
+// 取用后仍可能在队列中等待或正在播放的时长，期间不淘汰
+static const qint64 kPinnedMs = 120 * 1000;
+
+TimeAnnouncementCache::TimeAnnouncementCache(VoicePackIndex *index, QObject *parent) : QObject(parent), m_index(index)
+{
+	m_cacheDir = QStandardPaths::writableLocation(QStandardPaths::TempLocation).replace("\\", "/") +
+		     "/xhs_time_cache";
+	connect(m_index, &VoicePackIndex::indexChanged, this, &TimeAnnouncementCache::onIndexChanged);
+}
+
+TimeAnnouncementCache::~TimeAnnouncementCache()
+{
+	clear();
+}
+
+void TimeAnnouncementCache::setRoot(const QString &root)
+{
+	QString newRoot = root.isEmpty() ? QString() : QDir::cleanPath(QDir(root).absolutePath());
+	if (newRoot == m_root)
+		return;
+	m_root = newRoot;
+	clear();
+
+	// 清掉上次会话遗留的文件
+	QDir dir(m_cacheDir);
+	if (dir.exists())
+		dir.removeRecursively();
+	QDir().mkpath(m_cacheDir);
+}
+
+void TimeAnnouncementCache::setLimits(int lookaheadMinutes, int capacity)
+{
+	m_lookaheadMinutes = qMax(1, lookaheadMinutes);
+	m_capacity = qMax(1, capacity);
+	m_effectiveCapacity = m_capacity;
+	evict(m_effectiveCapacity);
+}
+
+QDateTime TimeAnnouncementCache::truncateToMinute(const QDateTime &time)
+{
+	return QDateTime(time.date(), QTime(time.time().hour(), time.time().minute()));
+}
+
+QString TimeAnnouncementCache::makeKey(const QDateTime &minute, const QString &prefixFile)
+{
+	return minute.toString("MMdd/HHmm/") + (prefixFile.isEmpty() ? QString("-") : prefixFile);
+}
+
+QString TimeAnnouncementCache::lookup(const QDateTime &time, const QString &prefixFile)
+{
+	if (m_root.isEmpty())
+		return "";
+
+	QDateTime minute = truncateToMinute(time);
+	QString key = makeKey(minute, prefixFile);
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+	auto it = m_entries.find(key);
+	if (it != m_entries.end() && QFile::exists(it->filePath)) {
+		it->lastUse = now;
+		m_lru.removeOne(key);
+		m_lru.append(key);
+		return it->filePath;
+	}
+
+	QString path = build(minute, prefixFile);
+	if (path.isEmpty())
+		return "";
+
+	// 只有一个片段时直接返回源文件，不进缓存，避免淘汰时误删素材
+	if (!path.startsWith(m_cacheDir))
+		return path;
+
+	Entry entry;
+	entry.filePath = path;
+	entry.minute = minute;
+	entry.lastUse = now;
+	insert(key, entry);
+	evict(m_effectiveCapacity);
+	return path;
+}
+
+void TimeAnnouncementCache::prebuild(const QDateTime &from)
+{
+	if (m_root.isEmpty())
+		return;
+
+	QStringList prefixes = m_index->files(m_root + "/prefix");
+	if (prefixes.isEmpty())
+		prefixes << QString();
+
+	// 容量至少能装下一轮完整的预生成，否则会边建边淘汰；现场拼接入缓存时也按这个容量
+	m_effectiveCapacity = qMax(m_capacity, (m_lookaheadMinutes + 1) * int(prefixes.size()));
+
+	QDateTime start = truncateToMinute(from);
+	for (int m = 0; m < m_lookaheadMinutes; ++m) {
+		QDateTime minute = start.addSecs(60 * m);
+		for (const QString &prefix : prefixes) {
+			QString key = makeKey(minute, prefix);
+			if (m_entries.contains(key))
+				continue;
+
+			QString path = build(minute, prefix);
+			if (path.isEmpty() || !path.startsWith(m_cacheDir))
+				continue;
+
+			Entry entry;
+			entry.filePath = path;
+			entry.minute = minute;
+			insert(key, entry);
+		}
+	}
+	// 整批建完后再统一淘汰，批内条目不会被彼此挤掉
+	evict(m_effectiveCapacity);
+}
+
+QString TimeAnnouncementCache::build(const QDateTime &minute, const QString &prefixFile)
+{
+	QStringList files;
+	if (!prefixFile.isEmpty())
+		files << prefixFile;
+	QString fDate = m_root + "/date/" + minute.toString("MMdd") + ".wav";
+	if (m_index->contains(fDate))
+		files << fDate;
+	QString fTime = m_root + "/time/" + minute.toString("HHmm") + ".wav";
+	if (m_index->contains(fTime))
+		files << fTime;
+
+	if (files.isEmpty())
+		return "";
+	if (files.size() == 1)
+		return files[0];
+
+	QDir().mkpath(m_cacheDir);
+	QString outPath = m_cacheDir + QString("/announce_%1.wav").arg(++m_seq);
+
+	QStringList rejected;
+	bool ok = concatWavFiles(files, outPath, &rejected);
+	for (const QString &f : rejected)
+		EventLog::instance().post(LogEvent::SpliceSkipped, f);
+
+	return ok ? outPath : "";
+}
+
+void TimeAnnouncementCache::insert(const QString &key, const Entry &entry)
+{
+	auto it = m_entries.find(key);
+	if (it != m_entries.end()) {
+		if (it->filePath != entry.filePath)
+			QFile::remove(it->filePath);
+		m_lru.removeOne(key);
+	}
+	m_entries.insert(key, entry);
+	m_lru.append(key);
+}
+
+void TimeAnnouncementCache::evict(int capacity)
+{
+	purgeOrphans();
+
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	QDateTime currentMinute = truncateToMinute(QDateTime::currentDateTime());
+
+	auto removeAt = [this](int i) {
+		QString key = m_lru.takeAt(i);
+		QFile::remove(m_entries.value(key).filePath);
+		m_entries.remove(key);
+	};
+	auto pinned = [now](const Entry &e) {
+		return e.lastUse > 0 && now - e.lastUse < kPinnedMs;
+	};
+
+	// 先淘汰已经过去的分钟，它们不会再被命中
+	for (int i = 0; i < m_lru.size();) {
+		const Entry &e = m_entries[m_lru[i]];
+		if (e.minute < currentMinute && !pinned(e))
+			removeAt(i);
+		else
+			++i;
+	}
+
+	// 再按 LRU 顺序淘汰，跳过仍可能在播放的条目
+	for (int i = 0; i < m_lru.size() && m_entries.size() > capacity;) {
+		if (pinned(m_entries[m_lru[i]]))
+			++i;
+		else
+			removeAt(i);
+	}
+}
+
+void TimeAnnouncementCache::purgeOrphans(bool force)
+{
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	for (int i = 0; i < m_orphans.size();) {
+		if (force || now >= m_orphans[i].releaseAt) {
+			QFile::remove(m_orphans[i].filePath);
+			m_orphans.removeAt(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+void TimeAnnouncementCache::clear()
+{
+	for (const Entry &e : m_entries)
+		QFile::remove(e.filePath);
+	m_entries.clear();
+	m_lru.clear();
+	purgeOrphans(true);
+}
+
+void TimeAnnouncementCache::onIndexChanged(const QString &dirPath)
+{
+	// 前缀/日期/时间素材变化后，已拼好的文件可能过时
+	if (m_root.isEmpty() || !dirPath.startsWith(m_root) || dirPath.endsWith("/noise"))
+		return;
+
+	// 正在排队/播放的文件只摘出缓存，等保护期结束后由下一次淘汰删除
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	for (const Entry &e : m_entries) {
+		if (e.lastUse == 0 || now - e.lastUse >= kPinnedMs)
+			QFile::remove(e.filePath);
+		else
+			m_orphans.append({e.filePath, e.lastUse + kPinnedMs});
+	}
+	m_entries.clear();
+	m_lru.clear();
+}
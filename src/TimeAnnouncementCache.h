@@ -0,0 +1,64 @@
+#pragma once
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+class VoicePackIndex;
+
+// 报时音频缓存：提前拼好未来 N 分钟 × 每种前缀的报时文件，触发报时只需查表
+// 容量有限，按 LRU 淘汰；只在后台 I/O 线程上使用，不加锁
+class TimeAnnouncementCache : public QObject {
+	Q_OBJECT
+public:
+	explicit TimeAnnouncementCache(VoicePackIndex *index, QObject *parent = nullptr);
+	~TimeAnnouncementCache();
+
+	void setRoot(const QString &root);
+	void setLimits(int lookaheadMinutes, int capacity);
+
+	// 命中直接返回缓存文件，未命中则现场拼接并放入缓存
+	QString lookup(const QDateTime &time, const QString &prefixFile);
+	// 预生成从 from 所在分钟起 N 分钟内的全部前缀组合
+	void prebuild(const QDateTime &from);
+
+private slots:
+	void onIndexChanged(const QString &dirPath);
+
+private:
+	struct Entry {
+		QString filePath;
+		QDateTime minute;
+		qint64 lastUse = 0; // 最近一次被报时取用的时间 (ms)，0 表示仅预生成
+	};
+
+	static QDateTime truncateToMinute(const QDateTime &time);
+	static QString makeKey(const QDateTime &minute, const QString &prefixFile);
+
+	QString build(const QDateTime &minute, const QString &prefixFile);
+	// 只登记条目，不淘汰；由调用方在合适的时机调用 evict
+	void insert(const QString &key, const Entry &entry);
+	void evict(int capacity);
+	// 删除已过保护期的摘出文件；force 时全部删除
+	void purgeOrphans(bool force = false);
+	void clear();
+
+	VoicePackIndex *m_index;
+	QString m_root;
+	QString m_cacheDir;
+	int m_lookaheadMinutes = 3;
+	int m_capacity = 64;
+	int m_effectiveCapacity = 64; // 不小于一轮完整预生成的条目数
+	quint64 m_seq = 0;
+
+	QHash<QString, Entry> m_entries;
+	QList<QString> m_lru; // 头部为最久未使用
+
+	// 素材变化时从缓存摘出、但仍可能在排队/播放的文件，保护期过后再删
+	struct Orphan {
+		QString filePath;
+		qint64 releaseAt = 0; // ms
+	};
+	QList<Orphan> m_orphans;
+};
@@ -0,0 +1,309 @@
+﻿#include "VoicePackIndex.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QThread>
+#include <QTimer>
+
+static const char *kVoicePackSubDirs[] = {"prefix", "noise", "date", "time"};
+
+VoicePackIndex::VoicePackIndex(QObject *parent) : QObject(parent)
+{
+	m_watcher = new QFileSystemWatcher(this);
+	connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &VoicePackIndex::onDirectoryChanged);
+
+	// 批量拷贝素材时目录事件会连续触发，合并后再刷新
+	m_rescanTimer = new QTimer(this);
+	m_rescanTimer->setSingleShot(true);
+	m_rescanTimer->setInterval(300);
+	connect(m_rescanTimer, &QTimer::timeout, this, &VoicePackIndex::flushPendingRescans);
+}
+
+QString VoicePackIndex::normalizeDir(const QString &dirPath)
+{
+	return QDir::cleanPath(QDir(dirPath).absolutePath());
+}
+
+QFileInfoList VoicePackIndex::listAudioFiles(const QString &dirPath)
+{
+	// 大小和修改时间随目录枚举一并取回 (多数平台不需要额外 stat)
+	return QDir(dirPath).entryInfoList(QStringList() << "*.wav" << "*.mp3", QDir::Files, QDir::Name);
+}
+
+void VoicePackIndex::setRoot(const QString &root)
+{
+	// 目录枚举可能很慢 (网络盘)，统一转到索引所属的后台线程执行
+	if (QThread::currentThread() != thread()) {
+		QMetaObject::invokeMethod(this, [this, root]() { setRoot(root); }, Qt::QueuedConnection);
+		return;
+	}
+
+	QString newRoot = root.isEmpty() ? QString() : normalizeDir(root);
+
+	{
+		QWriteLocker locker(&m_lock);
+		if (newRoot == m_root && !m_dirs.isEmpty())
+			return;
+		m_root = newRoot;
+		m_dirs.clear();
+	}
+	{
+		QMutexLocker locker(&m_lruMutex);
+		m_externalLru.clear();
+	}
+
+	QStringList watched = m_watcher->directories();
+	if (!watched.isEmpty())
+		m_watcher->removePaths(watched);
+	m_pendingRescans.clear();
+
+	if (newRoot.isEmpty())
+		return;
+
+	// 监听根目录本身，子目录后建时也能感知
+	watchDir(newRoot);
+
+	for (const char *sub : kVoicePackSubDirs) {
+		QString subDir = newRoot + "/" + sub;
+		ensureIndexed(subDir);
+		emit indexChanged(subDir);
+	}
+}
+
+void VoicePackIndex::watchDir(const QString &dir)
+{
+	// QFileSystemWatcher 只能在所属线程上操作
+	if (QThread::currentThread() != thread()) {
+		QMetaObject::invokeMethod(this, [this, dir]() { watchDir(dir); }, Qt::QueuedConnection);
+		return;
+	}
+	if (QFileInfo(dir).isDir() && !m_watcher->directories().contains(dir))
+		m_watcher->addPath(dir);
+}
+
+void VoicePackIndex::unwatchDir(const QString &dir)
+{
+	if (QThread::currentThread() != thread()) {
+		QMetaObject::invokeMethod(this, [this, dir]() { unwatchDir(dir); }, Qt::QueuedConnection);
+		return;
+	}
+	// 排队期间可能又被重新索引，仍在索引里的就继续监视
+	{
+		QReadLocker locker(&m_lock);
+		if (m_dirs.contains(dir))
+			return;
+	}
+	if (m_watcher->directories().contains(dir))
+		m_watcher->removePath(dir);
+	m_pendingRescans.remove(dir);
+}
+
+bool VoicePackIndex::isUnderRoot(const QString &dir) const
+{
+	// 调用方已持 m_lock
+	return !m_root.isEmpty() && (dir == m_root || dir.startsWith(m_root + "/"));
+}
+
+void VoicePackIndex::ensureIndexed(const QString &dir)
+{
+	bool external;
+	{
+		QReadLocker locker(&m_lock);
+		external = !isUnderRoot(dir);
+		if (m_dirs.contains(dir)) {
+			locker.unlock();
+			if (external)
+				touchExternal(dir);
+			return;
+		}
+	}
+	rescan(dir);
+	watchDir(dir);
+	if (external)
+		trackExternal(dir);
+}
+
+void VoicePackIndex::touchExternal(const QString &dir)
+{
+	QMutexLocker locker(&m_lruMutex);
+	int i = m_externalLru.indexOf(dir);
+	if (i >= 0 && i != m_externalLru.size() - 1)
+		m_externalLru.move(i, m_externalLru.size() - 1);
+}
+
+void VoicePackIndex::trackExternal(const QString &dir)
+{
+	QStringList evicted;
+	{
+		QMutexLocker locker(&m_lruMutex);
+		m_externalLru.removeOne(dir);
+		m_externalLru.append(dir);
+		while (m_externalLru.size() > kMaxExternalDirs)
+			evicted.append(m_externalLru.takeFirst());
+	}
+	if (evicted.isEmpty())
+		return;
+
+	{
+		QWriteLocker locker(&m_lock);
+		for (const QString &old : evicted)
+			m_dirs.remove(old);
+	}
+	for (const QString &old : evicted)
+		unwatchDir(old);
+}
+
+void VoicePackIndex::rescan(const QString &dir)
+{
+	// 目录枚举在锁外完成，避免慢盘阻塞读者
+	QFileInfoList entries = listAudioFiles(dir);
+	const int n = entries.size();
+
+	DirIndex idx;
+	idx.files.reserve(n);
+	idx.sizes.resize(n);
+	idx.mtimes.resize(n);
+	idx.wavInfos.resize(n);
+	idx.wavStates.fill(0, n);
+	idx.lookup.reserve(n);
+	for (int i = 0; i < n; ++i) {
+		const QFileInfo &fi = entries[i];
+		idx.files.append(fi.absoluteFilePath());
+		idx.sizes[i] = fi.size();
+		idx.mtimes[i] = fi.lastModified().toMSecsSinceEpoch();
+		idx.lookup.insert(fi.fileName(), i);
+	}
+
+	QWriteLocker locker(&m_lock);
+	const DirIndex old = m_dirs.value(dir);
+
+	// 增量：同名且大小、修改时间都没变的文件才沿用已解析的 WAV 元数据，原地替换的文件重新解析
+	for (int i = 0; i < n; ++i) {
+		auto it = old.lookup.constFind(entries[i].fileName());
+		if (it == old.lookup.constEnd())
+			continue;
+		int j = it.value();
+		if (old.sizes[j] == idx.sizes[i] && old.mtimes[j] == idx.mtimes[i]) {
+			idx.wavInfos[i] = old.wavInfos[j];
+			idx.wavStates[i] = old.wavStates[j];
+		}
+	}
+
+	m_dirs.insert(dir, idx);
+}
+
+QStringList VoicePackIndex::files(const QString &dirPath)
+{
+	QString dir = normalizeDir(dirPath);
+	ensureIndexed(dir);
+
+	QReadLocker locker(&m_lock);
+	return m_dirs.value(dir).files;
+}
+
+int VoicePackIndex::fileCount(const QString &dirPath)
+{
+	QString dir = normalizeDir(dirPath);
+	{
+		QReadLocker locker(&m_lock);
+		auto it = m_dirs.constFind(dir);
+		if (it != m_dirs.constEnd())
+			return it->files.size();
+	}
+
+	QMetaObject::invokeMethod(this, [this, dir]() { ensureIndexed(dir); }, Qt::QueuedConnection);
+	return -1;
+}
+
+bool VoicePackIndex::contains(const QString &filePath)
+{
+	QFileInfo fi(filePath);
+	QString dir = normalizeDir(fi.path());
+	ensureIndexed(dir);
+
+	QReadLocker locker(&m_lock);
+	auto it = m_dirs.constFind(dir);
+	return it != m_dirs.constEnd() && it->lookup.contains(fi.fileName());
+}
+
+WavInfo VoicePackIndex::wavInfo(const QString &filePath)
+{
+	QFileInfo fi(filePath);
+	QString dir = normalizeDir(fi.path());
+	QString name = fi.fileName();
+	ensureIndexed(dir);
+
+	{
+		QReadLocker locker(&m_lock);
+		auto it = m_dirs.constFind(dir);
+		if (it == m_dirs.constEnd())
+			return WavInfo();
+		int i = it->lookup.value(name, -1);
+		if (i < 0)
+			return WavInfo();
+		if (it->wavStates[i] != 0)
+			return it->wavInfos[i];
+	}
+
+	// 首次查询才读文件头，结果缓存到索引中
+	WavInfo info;
+	bool ok = fi.suffix().compare("wav", Qt::CaseInsensitive) == 0 && readWavInfo(fi.absoluteFilePath(), info);
+
+	QWriteLocker locker(&m_lock);
+	auto it = m_dirs.find(dir);
+	if (it != m_dirs.end()) {
+		int i = it->lookup.value(name, -1);
+		if (i >= 0) {
+			it->wavInfos[i] = info;
+			it->wavStates[i] = ok ? 1 : 2;
+		}
+	}
+	return info;
+}
+
+void VoicePackIndex::onDirectoryChanged(const QString &path)
+{
+	m_pendingRescans.insert(normalizeDir(path));
+	m_rescanTimer->start();
+}
+
+void VoicePackIndex::flushPendingRescans()
+{
+	QSet<QString> pending;
+	pending.swap(m_pendingRescans);
+
+	QString root;
+	{
+		QReadLocker locker(&m_lock);
+		root = m_root;
+	}
+
+	for (const QString &dir : pending) {
+		if (dir == root) {
+			// 根目录变化：补建新出现的子目录索引
+			for (const char *sub : kVoicePackSubDirs) {
+				QString subDir = root + "/" + sub;
+				if (!m_watcher->directories().contains(subDir)) {
+					rescan(subDir);
+					watchDir(subDir);
+					emit indexChanged(subDir);
+				}
+			}
+			continue;
+		}
+
+		bool known;
+		{
+			QReadLocker locker(&m_lock);
+			known = m_dirs.contains(dir);
+		}
+		if (!known)
+			continue;
+
+		rescan(dir);
+		// 目录被删除后重建时，watcher 会丢失该路径，需要重新挂上
+		watchDir(dir);
+		emit indexChanged(dir);
+	}
+}
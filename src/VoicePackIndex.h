@@ -0,0 +1,77 @@
+#pragma once
+#include <QObject>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+#include <QMutex>
+#include <QReadWriteLock>
+#include "WavFormat.h"
+
+class QFileSystemWatcher;
+class QTimer;
+
+// 语音包索引：目录只枚举一次，之后由 QFileSystemWatcher 增量刷新
+// 热路径 (抽取文件、统计数量、查询时长) 只读内存，不再触碰磁盘
+// 语音包根目录下的目录常驻索引；根目录以外的目录 (如 /play 传入的任意路径) 按最近使用保留有限个，
+// 淘汰时一并取消监视
+class VoicePackIndex : public QObject {
+	Q_OBJECT
+public:
+	explicit VoicePackIndex(QObject *parent = nullptr);
+
+	// 切换语音包根目录，在索引所属线程上预先枚举 prefix/noise/date/time 四个子目录
+	void setRoot(const QString &root);
+
+	// 以下接口均线程安全；除 fileCount 外，未索引过的目录会在首次访问时 (在调用线程上) 建立索引
+	QStringList files(const QString &dirPath);
+	// 只读缓存，可放心在 UI 线程调用；未索引时返回 -1 表示未知，并在后台补建
+	int fileCount(const QString &dirPath);
+	bool contains(const QString &filePath);
+	WavInfo wavInfo(const QString &filePath);
+
+signals:
+	void indexChanged(const QString &dirPath);
+
+private slots:
+	void onDirectoryChanged(const QString &path);
+	void flushPendingRescans();
+
+private:
+	// 每个目录一组紧凑数组：files[i] 与 sizes[i]/mtimes[i]/wavInfos[i]/wavStates[i] 一一对应
+	struct DirIndex {
+		QStringList files; // 绝对路径，按文件名排序
+		QVector<qint64> sizes;
+		QVector<qint64> mtimes; // 毫秒；与大小一起判断文件是否被原地替换
+		QVector<WavInfo> wavInfos;
+		QVector<quint8> wavStates; // 0 未解析, 1 有效, 2 无效
+		QHash<QString, int> lookup; // 文件名 -> 下标
+	};
+
+	static QString normalizeDir(const QString &dirPath);
+	static QFileInfoList listAudioFiles(const QString &dirPath);
+
+	void ensureIndexed(const QString &dir);
+	void watchDir(const QString &dir);
+	void unwatchDir(const QString &dir);
+	void rescan(const QString &dir);
+
+	bool isUnderRoot(const QString &dir) const;
+	// 根目录以外的目录：记录最近使用，超出上限时淘汰最久未用的
+	void touchExternal(const QString &dir);
+	void trackExternal(const QString &dir);
+
+	static constexpr int kMaxExternalDirs = 32;
+
+	QString m_root;
+	QHash<QString, DirIndex> m_dirs;
+	mutable QReadWriteLock m_lock;
+
+	QStringList m_externalLru; // 最久未用在前
+	QMutex m_lruMutex;
+
+	QFileSystemWatcher *m_watcher;
+	QTimer *m_rescanTimer;
+	QSet<QString> m_pendingRescans;
+};
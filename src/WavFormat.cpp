@@ -0,0 +1,195 @@
+﻿#include "WavFormat.h"
+#include <QFile>
+#include <QIODevice>
+#include <QtEndian>
+#include <cstring>
+
+static const quint16 kFormatExtensible = 0xFFFE;
+// KSDATAFORMAT_SUBTYPE_* 的公共后 14 字节，前 2 字节即传统格式标签
+static const unsigned char kSubFormatSuffix[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80,
+						   0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+
+bool readWavInfo(QIODevice &dev, WavInfo &info)
+{
+	info = WavInfo();
+	if (!dev.seek(0))
+		return false;
+
+	char riff[12];
+	if (dev.read(riff, 12) != 12 || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0)
+		return false;
+
+	const qint64 fileSize = dev.size();
+	qint64 pos = 12;
+	bool fmtFound = false;
+
+	while (pos + 8 <= fileSize) {
+		char chunk[8];
+		if (!dev.seek(pos) || dev.read(chunk, 8) != 8)
+			return false;
+		quint32 chunkSize = qFromLittleEndian<quint32>(chunk + 4);
+
+		if (memcmp(chunk, "fmt ", 4) == 0) {
+			if (chunkSize < 16)
+				return false;
+			char fmt[16];
+			if (dev.read(fmt, 16) != 16)
+				return false;
+			info.audioFormat = qFromLittleEndian<quint16>(fmt);
+			info.numChannels = qFromLittleEndian<quint16>(fmt + 2);
+			info.sampleRate = qFromLittleEndian<quint32>(fmt + 4);
+			info.byteRate = qFromLittleEndian<quint32>(fmt + 8);
+			info.blockAlign = qFromLittleEndian<quint16>(fmt + 12);
+			info.bitsPerSample = qFromLittleEndian<quint16>(fmt + 14);
+			info.subFormat = info.audioFormat;
+			if (info.audioFormat == kFormatExtensible) {
+				// 扩展头：cbSize(2) + 有效位数(2) + 声道掩码(4) + SubFormat GUID(16)
+				char ext[24];
+				info.subFormat = 0;
+				if (chunkSize >= 40 && dev.read(ext, 24) == 24 && qFromLittleEndian<quint16>(ext) >= 22 &&
+				    memcmp(ext + 10, kSubFormatSuffix, sizeof(kSubFormatSuffix)) == 0)
+					info.subFormat = qFromLittleEndian<quint16>(ext + 8);
+			}
+			fmtFound = true;
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			info.dataOffset = pos + 8;
+			info.dataSize = qMin<qint64>(chunkSize, fileSize - info.dataOffset);
+			// data 块一般在 fmt 之后，找到即可结束
+			return fmtFound && info.dataSize > 0;
+		}
+
+		// RIFF 块按偶数字节对齐
+		pos += 8 + chunkSize + (chunkSize & 1);
+	}
+	return false;
+}
+
+bool readWavInfo(const QString &filePath, WavInfo &info)
+{
+	QFile file(filePath);
+	if (!file.open(QIODevice::ReadOnly)) {
+		info = WavInfo();
+		return false;
+	}
+	return readWavInfo(file, info);
+}
+
+// 映射窗口与回退读缓冲的大小
+static const qint64 kCopyWindow = 1024 * 1024;
+static const qint64 kReadChunk = 64 * 1024;
+
+static bool copyPcmRange(QFile &in, qint64 offset, qint64 size, QFile &out)
+{
+	qint64 done = 0;
+	while (done < size) {
+		qint64 len = qMin(kCopyWindow, size - done);
+		uchar *mapped = in.map(offset + done, len);
+		if (mapped) {
+			qint64 written = out.write(reinterpret_cast<const char *>(mapped), len);
+			in.unmap(mapped);
+			if (written != len)
+				return false;
+			done += len;
+			continue;
+		}
+
+		// 部分文件系统不支持映射，退回固定缓冲分块读取
+		char buf[kReadChunk];
+		if (!in.seek(offset + done))
+			return false;
+		qint64 end = done + len;
+		while (done < end) {
+			qint64 got = in.read(buf, qMin(kReadChunk, end - done));
+			if (got <= 0 || out.write(buf, got) != got)
+				return false;
+			done += got;
+		}
+	}
+	return true;
+}
+
+static void writeWavHeader(char *h, const WavInfo &fmt, quint32 dataSize)
+{
+	memcpy(h, "RIFF", 4);
+	qToLittleEndian<quint32>(36 + dataSize, h + 4);
+	memcpy(h + 8, "WAVE", 4);
+	memcpy(h + 12, "fmt ", 4);
+	qToLittleEndian<quint32>(16, h + 16);
+	// 只写 16 字节的基本 fmt 块，格式标签用解析出的实际编码
+	qToLittleEndian<quint16>(fmt.subFormat, h + 20);
+	qToLittleEndian<quint16>(fmt.numChannels, h + 22);
+	qToLittleEndian<quint32>(fmt.sampleRate, h + 24);
+	qToLittleEndian<quint32>(fmt.byteRate, h + 28);
+	qToLittleEndian<quint16>(fmt.blockAlign, h + 32);
+	qToLittleEndian<quint16>(fmt.bitsPerSample, h + 34);
+	memcpy(h + 36, "data", 4);
+	qToLittleEndian<quint32>(dataSize, h + 40);
+}
+
+bool concatWavFiles(const QStringList &inputs, const QString &outputPath, QStringList *rejected)
+{
+	QFile out(outputPath);
+	if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	// 先写占位头，PCM 写完后再回填长度
+	char header[44] = {};
+	if (out.write(header, sizeof(header)) != (qint64)sizeof(header)) {
+		out.remove();
+		return false;
+	}
+
+	WavInfo format;
+	bool formatCaptured = false;
+	qint64 totalPcm = 0;
+
+	for (const QString &filePath : inputs) {
+		QFile in(filePath);
+		WavInfo info;
+		// 输出只写 16 字节的基本 fmt 块，只能承载整数 PCM 和 IEEE 浮点；ADPCM 等压缩编码直接拒绝
+		if (!in.open(QIODevice::ReadOnly) || !readWavInfo(in, info) || info.blockAlign == 0 ||
+		    (info.subFormat != 1 && info.subFormat != 3)) {
+			if (rejected)
+				rejected->append(filePath);
+			continue;
+		}
+
+		if (!formatCaptured) {
+			format = info;
+			formatCaptured = true;
+		} else if (!info.sameFormat(format)) {
+			// 格式不一致直接拼接会变成噪音，宁可跳过
+			if (rejected)
+				rejected->append(filePath);
+			continue;
+		}
+
+		// 按帧对齐，避免残缺采样导致声道错位
+		qint64 size = info.dataSize - info.dataSize % info.blockAlign;
+		if (totalPcm + size > 0xFFFFFFFFLL - 36) {
+			// 超出 RIFF 的 4GB 上限：不静默截断，整体失败
+			if (rejected)
+				rejected->append(filePath);
+			out.remove();
+			return false;
+		}
+		if (!copyPcmRange(in, info.dataOffset, size, out)) {
+			out.remove();
+			return false;
+		}
+		totalPcm += size;
+	}
+
+	if (totalPcm == 0) {
+		out.remove();
+		return false;
+	}
+
+	writeWavHeader(header, format, static_cast<quint32>(totalPcm));
+	if (!out.seek(0) || out.write(header, sizeof(header)) != (qint64)sizeof(header)) {
+		out.remove();
+		return false;
+	}
+	out.close();
+	return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <QtGlobal>
+#include <QString>
+#include <QStringList>
+
+class QIODevice;
+
+// WAV 头信息：只关心 fmt 与 data 两个块
+struct WavInfo {
+	quint16 audioFormat = 0; // fmt 块里的格式标签，可能是 0xFFFE (WAVE_FORMAT_EXTENSIBLE)
+	quint16 subFormat = 0;   // 实际采样编码：1 整数 PCM，3 IEEE 浮点；EXTENSIBLE 时取自 SubFormat GUID，无法识别为 0
+	quint16 numChannels = 0;
+	quint32 sampleRate = 0;
+	quint32 byteRate = 0;
+	quint16 blockAlign = 0;
+	quint16 bitsPerSample = 0;
+	qint64 dataOffset = 0; // PCM 数据在文件中的起始偏移
+	qint64 dataSize = 0;   // PCM 字节数 (已按文件实际长度截断)
+
+	bool isValid() const { return byteRate > 0 && dataOffset > 0; }
+	double duration() const { return byteRate > 0 ? (double)dataSize / byteRate : 0.0; }
+
+	// 采样率/声道/位深一致才能直接拼接 PCM
+	bool sameFormat(const WavInfo &o) const
+	{
+		return subFormat == o.subFormat && numChannels == o.numChannels && sampleRate == o.sampleRate &&
+		       bitsPerSample == o.bitsPerSample && blockAlign == o.blockAlign;
+	}
+};
+
+// 逐块解析 RIFF 头，只读取头部，不加载 PCM 数据
+bool readWavInfo(QIODevice &dev, WavInfo &info);
+bool readWavInfo(const QString &filePath, WavInfo &info);
+
+// 流式拼接多个 WAV：先写占位头，再按窗口映射/分块拷贝各源文件的 PCM，最后回填长度
+// 峰值内存只取决于拷贝窗口大小，与片段长度无关
+// 非整数 PCM / IEEE 浮点，或格式与首个有效片段不一致的文件会被跳过并记录到 rejected；
+// 总长度超出 4GB 时整体失败 (不输出截断的文件)，溢出的片段同样记录到 rejected
+bool concatWavFiles(const QStringList &inputs, const QString &outputPath, QStringList *rejected = nullptr);
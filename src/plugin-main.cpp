@@ -2,9 +2,12 @@
 #include <obs-frontend-api.h>
 #include <QMainWindow>
 #include <QAction>
+#include <QThread>
 #include "AudioController.h"
+#include "EventLog.h"
 #include "HttpServer.h"
 #include "Dashboard.h"
+#include "PcmAudioSource.h"
 
 // 必须导出的模块信息
 OBS_DECLARE_MODULE()
@@ -13,6 +16,7 @@ OBS_MODULE_USE_DEFAULT_LOCALE("xhs-guard", "en-US")
 // 全局静态变量，用于在菜单回调中访问仪表盘
 static Dashboard *g_dashboard = nullptr;
 static HttpServer *g_httpServer = nullptr;
+static QThread *g_httpThread = nullptr;
 
 /**
  * 🎯 新增：菜单点击后的回调函数
@@ -37,12 +41,33 @@ static void on_menu_toggle_dashboard(void *data)
  */
 bool obs_module_load(void)
 {
+	// 0. 注册内置 PCM 音频源 (可替代 ffmpeg 媒体源作为插播源)
+	registerPcmAudioSource();
+
+	// 事件日志写到模块配置目录的 logs 下，重启 OBS 后仍可查
+	char *logDir = obs_module_config_path("logs");
+	EventLog::instance().start(QString::fromUtf8(logDir));
+	bfree(logDir);
+
 	// 1. 初始化音频控制大脑
 	AudioController::instance().init();
 
 	// 2. 启动 HTTP 服务器 (监听 18888 端口)
+	// 服务器运行在独立线程的事件循环里，请求突发时不占用 OBS 界面线程
+	g_httpThread = new QThread();
+	g_httpThread->setObjectName("xhs-http");
 	g_httpServer = new HttpServer();
-	if (!g_httpServer->start(18888)) {
+	g_httpServer->moveToThread(g_httpThread);
+	QObject::connect(g_httpThread, &QThread::finished, g_httpServer, &QObject::deleteLater);
+	g_httpThread->start();
+
+	// listen 必须在服务器所属线程调用
+	bool listening = false;
+	QMetaObject::invokeMethod(
+		g_httpServer,
+		[&listening]() { listening = g_httpServer->start(AudioController::instance().getConfig(), 18888); },
+		Qt::BlockingQueuedConnection);
+	if (!listening) {
 		blog(LOG_ERROR, "[智播精灵] HTTP服务器启动失败，端口18888可能被占用");
 	} else {
 		blog(LOG_INFO, "[智播精灵] 原生中控已就绪，监听端口: 18888");
@@ -77,11 +102,21 @@ bool obs_module_load(void)
  */
 void obs_module_unload(void)
 {
-	if (g_httpServer) {
-		g_httpServer->close();
-		delete g_httpServer;
+	if (g_httpThread) {
+		// 先在服务线程内停止监听，线程退出时 deleteLater 回收服务器及其连接
+		QMetaObject::invokeMethod(g_httpServer, []() { g_httpServer->close(); }, Qt::BlockingQueuedConnection);
+		g_httpThread->quit();
+		g_httpThread->wait();
+		delete g_httpThread;
+		g_httpThread = nullptr;
 		g_httpServer = nullptr;
 	}
 
+	// 停止计时器并等待后台 I/O 线程退出
+	AudioController::instance().shutdown();
+
+	// 控制器停止后不再产生事件，写完剩余日志
+	EventLog::instance().stop();
+
 	// 注意：g_dashboard 是 mainWin 的子元素，OBS 会自动清理它，不需要手动 delete
 }
\ No newline at end of file
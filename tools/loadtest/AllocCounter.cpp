@@ -0,0 +1,120 @@
+﻿#include "AllocCounter.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+std::atomic<quint64> g_allocations{0};
+// 常量初始化的 thread_local，放在可执行文件里是静态 TLS，malloc 里访问不会再触发分配
+thread_local bool t_counting = false;
+
+inline void countAllocation()
+{
+	if (t_counting)
+		g_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+} // namespace
+
+#if defined(__GLIBC__)
+// 替换 glibc 的 malloc 入口：Qt 的 QArrayData 直接走 malloc，只重载 operator new 会漏掉大部分分配
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size)
+{
+	countAllocation();
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+	countAllocation();
+	return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	countAllocation();
+	return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+	__libc_free(ptr);
+}
+}
+#endif
+
+namespace AllocCounter {
+
+bool allocationsSupported()
+{
+#if defined(__GLIBC__)
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool syscallsSupported()
+{
+#if defined(__linux__)
+	return true;
+#else
+	return false;
+#endif
+}
+
+void setCountingThisThread(bool on)
+{
+	t_counting = on;
+}
+
+quint64 allocations()
+{
+	return g_allocations.load(std::memory_order_relaxed);
+}
+
+qint64 currentThreadId()
+{
+#if defined(__linux__)
+	return qint64(syscall(SYS_gettid));
+#else
+	return 0;
+#endif
+}
+
+Syscalls threadSyscalls(qint64 tid)
+{
+	Syscalls result;
+#if defined(__linux__)
+	// 在调用方线程读取，不计入被统计的线程
+	char path[64];
+	std::snprintf(path, sizeof(path), "/proc/self/task/%lld/io", (long long)tid);
+	FILE *file = std::fopen(path, "r");
+	if (!file)
+		return result;
+	char key[32];
+	unsigned long long value = 0;
+	while (std::fscanf(file, "%31[^:]: %llu\n", key, &value) == 2) {
+		if (qstrcmp(key, "syscr") == 0)
+			result.reads = value;
+		else if (qstrcmp(key, "syscw") == 0)
+			result.writes = value;
+	}
+	std::fclose(file);
+#else
+	Q_UNUSED(tid);
+#endif
+	return result;
+}
+
+} // namespace AllocCounter
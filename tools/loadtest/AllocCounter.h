@@ -0,0 +1,24 @@
+#pragma once
+#include <QtGlobal>
+
+// 微基准用的计数器：只统计打开了计数的线程上的堆分配次数和读写类系统调用次数
+namespace AllocCounter {
+
+// 当前平台能否统计分配 (需要 glibc，通过替换 malloc 系列实现)
+bool allocationsSupported();
+// 当前平台能否按线程统计系统调用 (Linux /proc/<pid>/task/<tid>/io)
+bool syscallsSupported();
+
+// 在要统计的线程上调用，开/关本线程的分配计数
+void setCountingThisThread(bool on);
+quint64 allocations();
+
+// 调用线程的内核线程号，供 threadSyscalls 在别的线程上读取
+qint64 currentThreadId();
+struct Syscalls {
+	quint64 reads = 0;
+	quint64 writes = 0;
+};
+Syscalls threadSyscalls(qint64 tid);
+
+} // namespace AllocCounter
@@ -0,0 +1,131 @@
+﻿// 压测用的 AudioController 替身：不接触 OBS 媒体源，只保留 HttpServer 用到的入口
+// 入队照常走无锁队列和指标，"播放" 由定时器按节拍把队列清空来模拟
+#include "AudioController.h"
+#include "Metrics.h"
+#include <QFileInfo>
+
+AudioController &AudioController::instance()
+{
+	static AudioController controller;
+	return controller;
+}
+
+AudioController::AudioController(QObject *parent) : QObject(parent)
+{
+	m_sources = nullptr;
+	m_voiceIndex = nullptr;
+	m_timeCache = nullptr;
+	m_ducking = nullptr;
+	m_ioThread = nullptr;
+	m_ioContext = nullptr;
+	m_playbackMonitorTimer = nullptr;
+	m_config = std::make_shared<PluginConfig>();
+	m_status = std::make_shared<StatusSnapshot>();
+	m_mainTimer = new QTimer(this);
+	connect(m_mainTimer, &QTimer::timeout, this, &AudioController::onTimerTick);
+}
+
+AudioController::~AudioController() {}
+
+void AudioController::init()
+{
+	m_mainTimer->start(100);
+}
+
+void AudioController::shutdown()
+{
+	m_mainTimer->stop();
+}
+
+// 不经过 ConfigStore，不读写配置文件
+void AudioController::setConfig(const PluginConfig &config)
+{
+	std::atomic_store(&m_config, std::shared_ptr<const PluginConfig>(std::make_shared<PluginConfig>(config)));
+	emit configChanged(config);
+}
+
+PluginConfig AudioController::getConfig() const
+{
+	return *std::atomic_load(&m_config);
+}
+
+void AudioController::applyConfig() {}
+
+QString AudioController::enqueueTaskAndReturn(const QString &path, const QString &type)
+{
+	qint64 startMicros = Metrics::nowMicros();
+	if (path.isEmpty())
+		return "";
+
+	AudioTask task;
+	task.filePath = path;
+	task.type = type;
+	task.addTime = QDateTime::currentMSecsSinceEpoch();
+	m_queue.push(task);
+	Metrics::instance().inc(Metrics::TasksEnqueued);
+	Metrics::instance().observeQueueDepth(m_queue.size());
+	Metrics::instance().record(Metrics::Enqueue, Metrics::nowMicros() - startMicros);
+	return QFileInfo(path).fileName();
+}
+
+QList<EnqueueResult> AudioController::enqueueBatch(const QList<EnqueueRequest> &requests)
+{
+	QList<EnqueueResult> results;
+	QList<AudioTask> tasks;
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	for (const EnqueueRequest &req : requests) {
+		EnqueueResult result;
+		if (!req.path.isEmpty()) {
+			AudioTask task;
+			task.filePath = req.path;
+			task.type = req.type;
+			task.addTime = now;
+			tasks.append(task);
+			result.file = QFileInfo(req.path).fileName();
+		}
+		results.append(result);
+	}
+
+	int position = m_queue.size();
+	m_queue.pushBatch(tasks);
+	for (EnqueueResult &result : results) {
+		if (!result.file.isEmpty())
+			result.position = ++position;
+	}
+	Metrics::instance().inc(Metrics::TasksEnqueued, quint64(tasks.size()));
+	Metrics::instance().observeQueueDepth(m_queue.size());
+	return results;
+}
+
+QList<SchedulerDecision> AudioController::recentDecisions() const
+{
+	return QList<SchedulerDecision>();
+}
+
+void AudioController::onTimerTick()
+{
+	publishStatus();
+
+	// 每个节拍把积压全部 "播完"，队列深度反映的是一个节拍内的突发量
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	AudioTask task;
+	while (m_queue.pop(task)) {
+		Metrics::instance().record(Metrics::QueueWait, (now - task.addTime) * 1000);
+		Metrics::instance().inc(Metrics::PlaybackStarted);
+	}
+}
+
+void AudioController::publishStatus()
+{
+	// 每个节拍都发布新版本，让 /events 推送路径也承受压测负载
+	std::shared_ptr<const StatusSnapshot> prev = std::atomic_load(&m_status);
+	auto next = std::make_shared<StatusSnapshot>();
+	next->version = prev->version + 1;
+	next->type = m_queue.isEmpty() ? "idle" : "playing_reply";
+	next->queueDepth = m_queue.size();
+	next->enabled = true;
+	std::atomic_store(&m_status, std::shared_ptr<const StatusSnapshot>(std::move(next)));
+	emit statusChanged();
+}
+
+void AudioController::checkMediaStatus() {}
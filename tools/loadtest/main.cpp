@@ -0,0 +1,467 @@
+﻿// HTTP 控制接口压测工具：在本进程内启动 HttpServer (替身控制器，不需要 OBS)，
+// 用可配置的并发、长连接和突发模式压 /status 与 /play，输出吞吐、尾延迟和内存
+// --bench 改为单连接逐个请求的微基准，输出服务器线程上每个请求的堆分配次数和读写系统调用次数；
+// 用 xhs-loadtest-baseline 跑同样的参数得到改动前的对照数据
+#include "AllocCounter.h"
+#include "AudioController.h"
+#include "HttpServer.h"
+#include "Metrics.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+struct Options {
+	quint16 port = 18899;
+	int connections = 16;
+	int requests = 20000;
+	int burst = 1;         // 每次连续发出 (流水线) 的请求数
+	int burstIntervalMs = 0;
+	int playPercent = 20;  // /play 占比，其余为 /status
+	bool keepAlive = true;
+	bool printMetrics = false;
+	bool bench = false;
+};
+
+QElapsedTimer g_clock;
+
+qint64 elapsedMicros()
+{
+	return g_clock.nsecsElapsed() / 1000;
+}
+
+// 峰值常驻内存 (KB)
+qint64 peakRssKb()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return qint64(pmc.PeakWorkingSetSize / 1024);
+	return 0;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return qint64(usage.ru_maxrss / 1024);
+#else
+	return qint64(usage.ru_maxrss);
+#endif
+#endif
+}
+
+class LoadRunner;
+
+// 一个客户端连接：按突发大小流水线发请求，逐个解析应答并记录延迟
+struct Client {
+	LoadRunner *runner = nullptr;
+	QTcpSocket *socket = nullptr;
+	QByteArray buffer;
+	QQueue<qint64> sentAt;
+};
+
+class LoadRunner {
+public:
+	explicit LoadRunner(const Options &options) : m_options(options) {}
+
+	void start()
+	{
+		m_remaining = m_options.requests;
+		m_startMicros = elapsedMicros();
+		m_latencies.reserve(m_options.requests);
+		for (int i = 0; i < m_options.connections; ++i) {
+			Client *client = new Client;
+			client->runner = this;
+			m_clients.append(client);
+			connectClient(client);
+		}
+	}
+
+	void report() const
+	{
+		double seconds = double(m_endMicros - m_startMicros) / 1e6;
+		QVector<qint64> sorted = m_latencies;
+		std::sort(sorted.begin(), sorted.end());
+		auto pct = [&sorted](double q) -> double {
+			if (sorted.isEmpty())
+				return 0.0;
+			int idx = qMin(int(sorted.size()) - 1, int(q * sorted.size()));
+			return double(sorted[idx]) / 1000.0;
+		};
+
+		std::printf("requests      %lld ok, %lld non-2xx, %lld socket errors\n", (long long)m_completed,
+			    (long long)m_non2xx, (long long)m_socketErrors);
+		std::printf("elapsed       %.3f s\n", seconds);
+		std::printf("throughput    %.0f req/s\n", seconds > 0 ? double(m_completed) / seconds : 0.0);
+		std::printf("latency (ms)  p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n", pct(0.5), pct(0.9),
+			    pct(0.99), pct(0.999), sorted.isEmpty() ? 0.0 : double(sorted.last()) / 1000.0);
+		std::printf("peak rss      %lld KB\n", (long long)peakRssKb());
+	}
+
+private:
+	void connectClient(Client *client)
+	{
+		client->buffer.clear();
+		client->sentAt.clear();
+		client->socket = new QTcpSocket();
+		QObject::connect(client->socket, &QTcpSocket::connected, [this, client]() { sendBurst(client); });
+		QObject::connect(client->socket, &QTcpSocket::readyRead, [this, client]() { onReadyRead(client); });
+		QObject::connect(client->socket, &QTcpSocket::errorOccurred,
+				 [this, client](QAbstractSocket::SocketError error) { onError(client, error); });
+		client->socket->connectToHost(QHostAddress::LocalHost, m_options.port);
+	}
+
+	void reconnect(Client *client)
+	{
+		client->socket->disconnect();
+		client->socket->abort();
+		client->socket->deleteLater();
+		client->socket = nullptr;
+		if (m_remaining > 0)
+			connectClient(client);
+		else
+			clientDone();
+	}
+
+	void sendBurst(Client *client)
+	{
+		int burst = m_options.keepAlive ? m_options.burst : 1;
+		QByteArray out;
+		for (int i = 0; i < burst && m_remaining > 0; ++i, --m_remaining) {
+			quint64 seq = m_sequence++;
+			QByteArray target = int(seq % 100) < m_options.playPercent
+						    ? "/play?path=/bench/reply_" + QByteArray::number(seq % 50) +
+							      ".wav&request_id=" + QByteArray::number(seq)
+						    : QByteArray("/status");
+			out += "GET " + target + " HTTP/1.1\r\nHost: 127.0.0.1\r\n";
+			out += m_options.keepAlive ? "\r\n" : "Connection: close\r\n\r\n";
+			client->sentAt.enqueue(elapsedMicros());
+		}
+		if (out.isEmpty()) {
+			reconnectOrFinish(client);
+			return;
+		}
+		client->socket->write(out);
+	}
+
+	void onReadyRead(Client *client)
+	{
+		client->buffer += client->socket->readAll();
+		for (;;) {
+			int headerEnd = client->buffer.indexOf("\r\n\r\n");
+			if (headerEnd < 0)
+				return;
+			QByteArray head = client->buffer.left(headerEnd);
+			int lengthPos = head.toLower().indexOf("content-length:");
+			int length = 0;
+			if (lengthPos >= 0) {
+				int lineEnd = head.indexOf("\r\n", lengthPos);
+				length = head.mid(lengthPos + 15, lineEnd < 0 ? -1 : lineEnd - lengthPos - 15).trimmed().toInt();
+			}
+			if (client->buffer.size() < headerEnd + 4 + length)
+				return;
+
+			int status = head.mid(9, 3).toInt();
+			client->buffer.remove(0, headerEnd + 4 + length);
+			if (!client->sentAt.isEmpty())
+				m_latencies.append(elapsedMicros() - client->sentAt.dequeue());
+			if (status >= 200 && status < 300)
+				++m_completed;
+			else
+				++m_non2xx;
+
+			if (client->sentAt.isEmpty()) {
+				if (!m_options.keepAlive) {
+					reconnectOrFinish(client);
+					return;
+				}
+				if (m_remaining <= 0) {
+					reconnectOrFinish(client);
+					return;
+				}
+				if (m_options.burstIntervalMs > 0)
+					QTimer::singleShot(m_options.burstIntervalMs, client->socket,
+							   [this, client]() { sendBurst(client); });
+				else
+					sendBurst(client);
+			}
+		}
+	}
+
+	void onError(Client *client, QAbstractSocket::SocketError error)
+	{
+		// 服务端按 Connection: close 主动断开属于正常结束
+		if (error == QAbstractSocket::RemoteHostClosedError && client->sentAt.isEmpty())
+			return;
+		m_socketErrors += qMax(1, int(client->sentAt.size()));
+		QTimer::singleShot(0, [this, client]() { reconnectOrFinish(client); });
+	}
+
+	void reconnectOrFinish(Client *client)
+	{
+		if (!client->socket)
+			return;
+		reconnect(client);
+	}
+
+	void clientDone()
+	{
+		if (++m_finishedClients == m_clients.size()) {
+			m_endMicros = elapsedMicros();
+			QCoreApplication::quit();
+		}
+	}
+
+	Options m_options;
+	QList<Client *> m_clients;
+	QVector<qint64> m_latencies;
+	qint64 m_remaining = 0;
+	quint64 m_sequence = 0;
+	qint64 m_completed = 0;
+	qint64 m_non2xx = 0;
+	qint64 m_socketErrors = 0;
+	int m_finishedClients = 0;
+	qint64 m_startMicros = 0;
+	qint64 m_endMicros = 0;
+};
+
+// 单连接、一问一答地发请求，返回应答状态码，失败返回 -1
+int roundTrip(QTcpSocket &socket, const QByteArray &request, QByteArray &buffer)
+{
+	socket.write(request);
+	if (!socket.waitForBytesWritten(3000))
+		return -1;
+	for (;;) {
+		int headerEnd = buffer.indexOf("\r\n\r\n");
+		if (headerEnd >= 0) {
+			QByteArray head = buffer.left(headerEnd);
+			int lengthPos = head.toLower().indexOf("content-length:");
+			int length = 0;
+			if (lengthPos >= 0) {
+				int lineEnd = head.indexOf("\r\n", lengthPos);
+				length = head.mid(lengthPos + 15, lineEnd < 0 ? -1 : lineEnd - lengthPos - 15).trimmed().toInt();
+			}
+			if (buffer.size() >= headerEnd + 4 + length) {
+				int status = head.mid(9, 3).toInt();
+				buffer.remove(0, headerEnd + 4 + length);
+				return status;
+			}
+		}
+		if (!socket.waitForReadyRead(3000))
+			return -1;
+		buffer += socket.readAll();
+	}
+}
+
+// 微基准：每条路由先预热，再统计服务器线程上 N 个请求的分配和系统调用增量取平均
+int runMicroBench(HttpServer *server, const Options &options)
+{
+	qint64 serverTid = 0;
+	QMetaObject::invokeMethod(
+		server,
+		[&serverTid]() {
+			serverTid = AllocCounter::currentThreadId();
+			AllocCounter::setCountingThisThread(true);
+		},
+		Qt::BlockingQueuedConnection);
+
+	QTcpSocket socket;
+	socket.connectToHost(QHostAddress::LocalHost, options.port);
+	if (!socket.waitForConnected(3000)) {
+		std::fprintf(stderr, "failed to connect to port %u\n", unsigned(options.port));
+		return 1;
+	}
+
+	struct Route {
+		const char *name;
+		std::function<QByteArray(quint64)> request;
+	};
+	const Route routes[] = {
+		{"GET /status", [](quint64) { return QByteArray("GET /status HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"); }},
+		{"OPTIONS /play", [](quint64) { return QByteArray("OPTIONS /play HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"); }},
+		{"GET /missing (404)",
+		 [](quint64) { return QByteArray("GET /missing HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"); }},
+		{"GET /play",
+		 [](quint64 seq) {
+			 return "GET /play?path=/bench/reply_" + QByteArray::number(seq % 50) +
+				".wav&request_id=" + QByteArray::number(seq) + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+		 }},
+	};
+
+	const int warmup = qMin(200, options.requests);
+#ifdef XHS_HTTP_BASELINE_RESPONSES
+	const char *responsePath = "baseline (per-header writes + flush)";
+#else
+	const char *responsePath = "current (single buffer, prebuilt fixed replies)";
+#endif
+	std::printf("micro-benchmark, %d requests per route on one keep-alive connection (server thread only)\n",
+		    options.requests);
+	std::printf("response path: %s\n", responsePath);
+	if (!AllocCounter::allocationsSupported())
+		std::printf("allocation counting needs glibc, reported as n/a\n");
+	if (!AllocCounter::syscallsSupported())
+		std::printf("per-thread syscall counting needs Linux, reported as n/a\n");
+	std::printf("%-20s %12s %14s %14s\n", "route", "allocs/req", "read sc/req", "write sc/req");
+
+	QByteArray buffer;
+	quint64 seq = 0;
+	int failures = 0;
+	for (const Route &route : routes) {
+		for (int i = 0; i < warmup; ++i) {
+			if (roundTrip(socket, route.request(seq++), buffer) < 0)
+				++failures;
+		}
+
+		// 请求报文在计数窗口外构造好，客户端本身不在服务器线程上，不影响统计
+		QList<QByteArray> requests;
+		requests.reserve(options.requests);
+		for (int i = 0; i < options.requests; ++i)
+			requests.append(route.request(seq++));
+
+		quint64 allocBefore = AllocCounter::allocations();
+		AllocCounter::Syscalls scBefore = AllocCounter::threadSyscalls(serverTid);
+		for (const QByteArray &request : requests) {
+			if (roundTrip(socket, request, buffer) < 0)
+				++failures;
+		}
+		AllocCounter::Syscalls scAfter = AllocCounter::threadSyscalls(serverTid);
+		quint64 allocAfter = AllocCounter::allocations();
+
+		double n = double(options.requests);
+		char allocs[32] = "n/a", reads[32] = "n/a", writes[32] = "n/a";
+		if (AllocCounter::allocationsSupported())
+			std::snprintf(allocs, sizeof(allocs), "%.2f", double(allocAfter - allocBefore) / n);
+		if (AllocCounter::syscallsSupported()) {
+			std::snprintf(reads, sizeof(reads), "%.2f", double(scAfter.reads - scBefore.reads) / n);
+			std::snprintf(writes, sizeof(writes), "%.2f", double(scAfter.writes - scBefore.writes) / n);
+		}
+		std::printf("%-20s %12s %14s %14s\n", route.name, allocs, reads, writes);
+	}
+
+	// 入队路径：直接在本线程上统计替身控制器的 enqueueTaskAndReturn
+	AllocCounter::setCountingThisThread(true);
+	QString path = QStringLiteral("/bench/reply_0.wav");
+	QString type = QStringLiteral("reply");
+	quint64 allocBefore = AllocCounter::allocations();
+	for (int i = 0; i < options.requests; ++i)
+		AudioController::instance().enqueueTaskAndReturn(path, type);
+	quint64 allocAfter = AllocCounter::allocations();
+	AllocCounter::setCountingThisThread(false);
+	if (AllocCounter::allocationsSupported())
+		std::printf("%-20s %12.2f\n", "enqueue (in-thread)", double(allocAfter - allocBefore) / double(options.requests));
+
+	QMetaObject::invokeMethod(
+		server, []() { AllocCounter::setCountingThisThread(false); }, Qt::BlockingQueuedConnection);
+	socket.disconnectFromHost();
+
+	if (failures)
+		std::printf("%d requests failed\n", failures);
+	return failures ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("xhs-loadtest");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Load test for the xhs-guard HTTP control API (no OBS required).");
+	parser.addHelpOption();
+	QCommandLineOption portOpt("port", "Port for the in-process server.", "port", "18899");
+	QCommandLineOption connOpt({"c", "connections"}, "Concurrent client connections.", "n", "16");
+	QCommandLineOption reqOpt({"n", "requests"}, "Total requests to send.", "n", "20000");
+	QCommandLineOption burstOpt({"b", "burst"}, "Pipelined requests per burst (keep-alive only).", "n", "1");
+	QCommandLineOption intervalOpt("burst-interval", "Pause between bursts on a connection (ms).", "ms", "0");
+	QCommandLineOption playOpt("play-percent", "Share of /play requests, the rest hit /status.", "pct", "20");
+	QCommandLineOption closeOpt("no-keep-alive", "Open a new connection for every request.");
+	QCommandLineOption rateOpt("rate-limit", "Per-client rate limit (req/s), 0 disables.", "rps", "0");
+	QCommandLineOption maxConnOpt("max-connections", "Server connection cap, 0 disables.", "n", "0");
+	QCommandLineOption metricsOpt("metrics", "Print the server's Prometheus metrics afterwards.");
+	QCommandLineOption benchOpt("bench",
+				    "Per-request allocation and syscall micro-benchmark (sequential, one connection).");
+	parser.addOptions({portOpt, connOpt, reqOpt, burstOpt, intervalOpt, playOpt, closeOpt, rateOpt, maxConnOpt,
+			   metricsOpt, benchOpt});
+	parser.process(app);
+
+	Options options;
+	options.port = quint16(parser.value(portOpt).toUInt());
+	options.connections = qMax(1, parser.value(connOpt).toInt());
+	options.requests = qMax(1, parser.value(reqOpt).toInt());
+	options.burst = qMax(1, parser.value(burstOpt).toInt());
+	options.burstIntervalMs = qMax(0, parser.value(intervalOpt).toInt());
+	options.playPercent = qBound(0, parser.value(playOpt).toInt(), 100);
+	options.keepAlive = !parser.isSet(closeOpt);
+	options.printMetrics = parser.isSet(metricsOpt);
+	options.bench = parser.isSet(benchOpt);
+
+	// 压测默认关掉限流、连接上限和去重，测的是处理路径本身
+	PluginConfig config;
+	config.httpBindAddress = "127.0.0.1";
+	config.httpRatePerSecond = parser.value(rateOpt).toDouble();
+	config.httpMaxConnections = parser.value(maxConnOpt).toInt();
+	config.dedupWindowMs = 0;
+	AudioController::instance().setConfig(config);
+	AudioController::instance().init();
+
+	// 与插件相同：服务器跑在独立线程，客户端在主线程
+	QThread serverThread;
+	HttpServer *server = new HttpServer();
+	server->moveToThread(&serverThread);
+	QObject::connect(&serverThread, &QThread::finished, server, &QObject::deleteLater);
+	serverThread.start();
+
+	bool listening = false;
+	QMetaObject::invokeMethod(
+		server, [&]() { listening = server->start(config, options.port); }, Qt::BlockingQueuedConnection);
+	if (!listening) {
+		std::fprintf(stderr, "failed to listen on port %u\n", unsigned(options.port));
+		serverThread.quit();
+		serverThread.wait();
+		return 1;
+	}
+
+	if (options.bench) {
+		int rc = runMicroBench(server, options);
+		QMetaObject::invokeMethod(server, [server]() { server->close(); }, Qt::BlockingQueuedConnection);
+		serverThread.quit();
+		serverThread.wait();
+		AudioController::instance().shutdown();
+		return rc;
+	}
+
+	std::printf("connections %d, requests %d, burst %d, keep-alive %s, /play %d%%\n", options.connections,
+		    options.requests, options.burst, options.keepAlive ? "on" : "off", options.playPercent);
+
+	g_clock.start();
+	LoadRunner runner(options);
+	QTimer::singleShot(0, [&runner]() { runner.start(); });
+	app.exec();
+
+	runner.report();
+	if (options.printMetrics)
+		std::fputs(Metrics::instance().exportPrometheus(AudioController::instance().queueDepth()).constData(),
+			   stdout);
+
+	QMetaObject::invokeMethod(server, [server]() { server->close(); }, Qt::BlockingQueuedConnection);
+	serverThread.quit();
+	serverThread.wait();
+	AudioController::instance().shutdown();
+	return 0;
+}
@@ -0,0 +1,195 @@
+﻿// TaskQueue 多生产者压力测试：N 个线程混用 push / pushBatch 写入三种任务，单消费者取出并校验
+//   - 不丢、不重：每个任务恰好取出一次
+//   - 同一生产者在同一道内保持 FIFO
+//   - 单生产者且不延后噪音时，跨道也按入队先后取出 (批量入队不会先露出批内靠后的任务)；
+//     多生产者时另一生产者发布到一半会暂时挡住该道，跨道乱序只统计不判失败
+// 失败时返回非零退出码
+#include "TaskQueue.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+	int producers = 8;
+	int tasksPerProducer = 200000;
+	int maxBatch = 8; // 0 表示只用 push
+	bool deferNoise = false;
+	int rounds = 1;
+};
+
+const char *const kTypes[] = {"reply", "time", "noise"};
+
+// 生产者编号和序号编码进 addTime，消费端不解析字符串
+qint64 encode(int producer, int index)
+{
+	return (qint64(producer) << 32) | quint32(index);
+}
+
+int typeIndexFor(int producer, int index)
+{
+	// 让各生产者的类型序列错开，避免所有线程同时挤在同一道
+	return int((quint32(index) * 2654435761u + quint32(producer)) >> 16) % 3;
+}
+
+void produce(TaskQueue &queue, const Options &opt, int producer, const std::atomic<bool> &go)
+{
+	while (!go.load(std::memory_order_acquire))
+		std::this_thread::yield();
+
+	quint32 rng = quint32(producer) * 747796405u + 1;
+	int index = 0;
+	while (index < opt.tasksPerProducer) {
+		rng = rng * 1664525u + 1013904223u;
+		int batch = opt.maxBatch > 0 ? int(rng >> 24) % (opt.maxBatch + 1) : 0;
+		if (batch <= 1) {
+			AudioTask task;
+			task.type = kTypes[typeIndexFor(producer, index)];
+			task.addTime = encode(producer, index);
+			queue.push(task);
+			++index;
+			continue;
+		}
+
+		QList<AudioTask> tasks;
+		tasks.reserve(batch);
+		for (int i = 0; i < batch && index < opt.tasksPerProducer; ++i, ++index) {
+			AudioTask task;
+			task.type = kTypes[typeIndexFor(producer, index)];
+			task.addTime = encode(producer, index);
+			tasks.append(task);
+		}
+		queue.pushBatch(tasks);
+	}
+}
+
+bool runRound(const Options &opt, int round)
+{
+	TaskQueue queue;
+	const qint64 total = qint64(opt.producers) * opt.tasksPerProducer;
+
+	std::vector<char> seen(size_t(total), 0);
+	// lastInLane[p * 3 + lane]: 该生产者在该道上最近取出的序号
+	std::vector<int> lastInLane(size_t(opt.producers) * 3, -1);
+	std::vector<int> lastAny(size_t(opt.producers), -1);
+	qint64 duplicates = 0, laneOrderErrors = 0, crossOrderErrors = 0, badTasks = 0;
+
+	std::atomic<bool> go{false};
+	std::vector<std::thread> threads;
+	threads.reserve(size_t(opt.producers));
+	for (int p = 0; p < opt.producers; ++p)
+		threads.emplace_back(produce, std::ref(queue), std::cref(opt), p, std::cref(go));
+
+	QElapsedTimer timer;
+	timer.start();
+	go.store(true, std::memory_order_release);
+
+	qint64 received = 0, emptyPolls = 0;
+	AudioTask task;
+	while (received < total) {
+		if (!queue.pop(task, opt.deferNoise)) {
+			++emptyPolls;
+			std::this_thread::yield();
+			continue;
+		}
+		++received;
+
+		int producer = int(task.addTime >> 32);
+		int index = int(task.addTime & 0xffffffff);
+		if (producer < 0 || producer >= opt.producers || index < 0 || index >= opt.tasksPerProducer) {
+			++badTasks;
+			continue;
+		}
+		int lane = typeIndexFor(producer, index);
+		if (task.type != QLatin1String(kTypes[lane])) {
+			++badTasks;
+			continue;
+		}
+
+		char &flag = seen[size_t(producer) * opt.tasksPerProducer + index];
+		if (flag)
+			++duplicates;
+		flag = 1;
+
+		int &last = lastInLane[size_t(producer) * 3 + lane];
+		if (index <= last)
+			++laneOrderErrors;
+		last = index;
+
+		if (!opt.deferNoise) {
+			if (index <= lastAny[producer])
+				++crossOrderErrors;
+			lastAny[producer] = index;
+		}
+	}
+	qint64 elapsedMs = timer.elapsed();
+
+	for (std::thread &t : threads)
+		t.join();
+
+	qint64 missing = 0;
+	for (char flag : seen) {
+		if (!flag)
+			++missing;
+	}
+	// 所有生产者都已结束，队列必须为空
+	qint64 leftover = 0;
+	while (queue.pop(task, false))
+		++leftover;
+
+	bool crossOrderFatal = opt.producers == 1;
+	bool ok = !duplicates && !missing && !laneOrderErrors && !(crossOrderFatal && crossOrderErrors) && !badTasks &&
+		  !leftover && queue.isEmpty();
+
+	std::printf("round %d: %s  %lld tasks in %lld ms (%.0f tasks/s), empty polls %lld\n", round + 1,
+		    ok ? "PASS" : "FAIL", (long long)total, (long long)elapsedMs,
+		    elapsedMs > 0 ? double(total) * 1000.0 / double(elapsedMs) : 0.0, (long long)emptyPolls);
+	if (!opt.deferNoise && !crossOrderFatal)
+		std::printf("  cross-lane reorders (informational) %lld\n", (long long)crossOrderErrors);
+	if (!ok) {
+		std::printf("  missing %lld, duplicates %lld, lane order errors %lld, cross-lane order errors %lld, "
+			    "bad tasks %lld, leftover %lld\n",
+			    (long long)missing, (long long)duplicates, (long long)laneOrderErrors,
+			    (long long)crossOrderErrors, (long long)badTasks, (long long)leftover);
+	}
+	return ok;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("xhs-queuestress");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Multi-producer stress test for TaskQueue");
+	parser.addHelpOption();
+	QCommandLineOption producersOpt({"p", "producers"}, "Producer threads.", "n", "8");
+	QCommandLineOption tasksOpt({"n", "tasks"}, "Tasks per producer.", "n", "200000");
+	QCommandLineOption batchOpt({"b", "max-batch"}, "Max pushBatch size, 0 = push only.", "n", "8");
+	QCommandLineOption roundsOpt({"r", "rounds"}, "Repeat the whole run.", "n", "1");
+	QCommandLineOption deferOpt("defer-noise", "Pop with deferNoise (disables the cross-lane order check).");
+	parser.addOptions({producersOpt, tasksOpt, batchOpt, roundsOpt, deferOpt});
+	parser.process(app);
+
+	Options opt;
+	opt.producers = qBound(1, parser.value(producersOpt).toInt(), 256);
+	opt.tasksPerProducer = qMax(1, parser.value(tasksOpt).toInt());
+	opt.maxBatch = qMax(0, parser.value(batchOpt).toInt());
+	opt.rounds = qMax(1, parser.value(roundsOpt).toInt());
+	opt.deferNoise = parser.isSet(deferOpt);
+
+	std::printf("producers %d, tasks/producer %d, max batch %d, defer noise %s\n", opt.producers,
+		    opt.tasksPerProducer, opt.maxBatch, opt.deferNoise ? "on" : "off");
+
+	bool ok = true;
+	for (int round = 0; round < opt.rounds; ++round)
+		ok = runRound(opt, round) && ok;
+	return ok ? 0 : 1;
+}